@@ -0,0 +1,223 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "Wire.h"
+
+#include "TM8_accel.h"
+
+#include <Arduino.h>
+#include <TM8_sleep.h>
+
+//----------------------------------------------------------------------------
+
+// mg per digit, indexed [mode][full scale]. straight from the LIS3DH datasheet table 4
+static const uint8_t sensitivity[3][4] =
+{
+  {16, 32, 64, 192}, // low power
+  { 4,  8, 16,  48}, // normal
+  { 1,  2,  4,  12}, // high resolution
+};
+
+static const uint8_t dataShift[3] = {8, 6, 4};
+
+// Hz for each ODR code. 1600/1344 depend on mode, see ACCEL_ODR_*
+static const uint16_t odrTable[10] = {0, 1, 10, 25, 50, 100, 200, 400, 1600, 1344};
+
+TM8_accel::TM8_accel(TwoWire *bus, uint8_t addr)
+{
+  wire = bus;
+  address = addr;
+  shift = 6;
+  mgPerDigit = 4;
+  odr = ACCEL_ODR_OFF;
+  fifoWatermark = 0;
+  onBatch = 0;
+}
+
+/*
+configures ODR, full scale (2, 4, 8 or 16 g) and resolution with all axes on.
+block data update is always on so a burst read never mixes high and low bytes from two samples.
+returns 0 if the chip didn't answer WHO_AM_I
+*/
+bool TM8_accel::begin(uint8_t rate, uint8_t range, uint8_t mode) {
+  uint8_t fs = 0;
+  if (range > 8) fs = 3;
+  else if (range > 4) fs = 2;
+  else if (range > 2) fs = 1;
+  if (mode > ACCEL_MODE_HR) mode = ACCEL_MODE_HR;
+
+  shift = dataShift[mode];
+  mgPerDigit = sensitivity[mode][fs];
+  odr = rate;
+
+  writeReg(LIS3DH_CTRL_REG1, (odr << 4) | (mode == ACCEL_MODE_LP ? 0x08 : 0x00) | 0x07);
+  writeReg(LIS3DH_CTRL_REG4, 0x80 | (fs << 4) | (mode == ACCEL_MODE_HR ? 0x08 : 0x00));
+
+  return readReg(0x0F) == 0x33; // WHO_AM_I
+}
+
+bool TM8_accel::read(TM8_accelSample &s) {
+  uint8_t raw[6];
+  if (readRegs(LIS3DH_OUT_X_L, raw, 6) != 6) return 0;
+  convert(raw, s);
+  return 1;
+}
+
+void TM8_accel::convert(const uint8_t *raw, TM8_accelSample &s) {
+  // arithmetic shift keeps the sign, then scale to mg in integer math
+  s.x = (int16_t)(raw[0] | (raw[1] << 8)) >> shift;
+  s.y = (int16_t)(raw[2] | (raw[3] << 8)) >> shift;
+  s.z = (int16_t)(raw[4] | (raw[5] << 8)) >> shift;
+  s.x *= mgPerDigit;
+  s.y *= mgPerDigit;
+  s.z *= mgPerDigit;
+}
+
+/*
+FIFO batching.
+The 32 sample FIFO runs in stream mode so it never stops sampling, and the MCU
+only has to show up once per watermark's worth of samples. The watermark flag
+can only be routed to INT1, which isn't wired on TM8 (only INT2 goes to PA03),
+so the MCU sleeps for batchPeriod() on TC3 instead of waiting on an EIC line.
+*/
+bool TM8_accel::fifoBegin(uint8_t watermark, TM8_accelBatchFn consumer) {
+  if (watermark == 0 || watermark >= ACCEL_FIFO_DEPTH) watermark = ACCEL_FIFO_DEPTH - 1;
+  fifoWatermark = watermark;
+  onBatch = consumer;
+
+  writeReg(LIS3DH_FIFO_CTRL, 0x00); // bypass first, clears whatever was left in the FIFO
+  writeReg(LIS3DH_CTRL_REG5, readReg(LIS3DH_CTRL_REG5) | 0x40); // FIFO_EN
+  writeReg(LIS3DH_FIFO_CTRL, 0x80 | watermark); // stream mode, FTH = watermark
+  return (readReg(LIS3DH_FIFO_CTRL) & 0x1F) == watermark;
+}
+
+void TM8_accel::fifoEnd(void) {
+  writeReg(LIS3DH_FIFO_CTRL, 0x00);
+  writeReg(LIS3DH_CTRL_REG5, readReg(LIS3DH_CTRL_REG5) & ~0x40);
+  onBatch = 0;
+}
+
+/*
+reading from OUT_X_L with auto-increment rolls back to OUT_X_L after OUT_Z_H
+while the FIFO is on, so the whole backlog comes out in one transaction
+*/
+uint8_t TM8_accel::fifoDrain(TM8_accelSample *buf) {
+  uint8_t src = readReg(LIS3DH_FIFO_SRC);
+  uint8_t n = src & 0x1F;
+  if (src & 0x40) n = ACCEL_FIFO_DEPTH; // overrun, FSS tops out at 31
+  if (src & 0x20 || n == 0) return 0; // empty
+
+  uint8_t raw[ACCEL_FIFO_DEPTH * 6];
+  n = readRegs(LIS3DH_OUT_X_L, raw, n * 6) / 6;
+  for (uint8_t i=0; i<n; i++) {
+    convert(&raw[i * 6], buf[i]);
+  }
+  return n;
+}
+
+bool TM8_accel::fifoReady(void) {
+  return readReg(LIS3DH_FIFO_SRC) & 0xC0; // WTM or OVRN
+}
+
+uint8_t TM8_accel::service(void) {
+  if (!fifoReady()) return 0;
+
+  TM8_accelSample batch[ACCEL_FIFO_DEPTH];
+  uint8_t n = fifoDrain(batch);
+  if (n && onBatch) onBatch(batch, n);
+  return n;
+}
+
+// sleep for roughly one batch. whatever else woke us (buttons, ALRT) cuts it short
+void TM8_accel::sleepUntilBatch(void) {
+  Sleep.nap(batchPeriod(), true);
+}
+
+uint32_t TM8_accel::batchPeriod(void) {
+  uint16_t hz = odrHz();
+  if (hz == 0) return 1000;
+  return (uint32_t)fifoWatermark * 1000 / hz;
+}
+
+uint16_t TM8_accel::odrHz(void) {
+  return odr < sizeof(odrTable) / sizeof(odrTable[0]) ? odrTable[odr] : 0;
+}
+
+void TM8_accel::powerDown(void) {
+  writeReg(LIS3DH_CTRL_REG1, 0x08); // ODR off, LPen
+  odr = ACCEL_ODR_OFF;
+}
+
+/*
+Wake gestures.
+Both detectors run inside the LIS3DH and only raise INT2 (PA03) when they fire,
+so the MCU can stay in STANDBY with nothing polling.
+ - double tap: click engine on all axes, through the high pass filter so gravity doesn't count
+ - raise: interrupt generator 1 in 6D movement mode, fires once when the face turns up and
+   stays up for DUR samples. position mode would hold INT2 for as long as the watch lies
+   face up, and latch again DUR after every gestureSource()
+Thresholds assume +-2g, 1 LSB = 16mg, and ODR counts assume 50Hz, the same
+8 bit stream the pedometer reads out of the FIFO. Low power mode at 50Hz is about 6uA.
+*/
+void TM8_accel::gestureBegin(void) {
+  begin(ACCEL_ODR_50, 2, ACCEL_MODE_LP);
+
+  writeReg(LIS3DH_CTRL_REG2, 0x04); // HPCLICK
+  writeReg(LIS3DH_CLICK_CFG, 0x2A); // ZD | YD | XD
+  writeReg(LIS3DH_CLICK_THS, 0x80 | 40); // LIR_Click, 640mg
+  writeReg(LIS3DH_TIME_LIMIT, 5); // tap shorter than 100ms
+  writeReg(LIS3DH_TIME_LATENCY, 10); // 200ms dead time after the first tap
+  writeReg(LIS3DH_TIME_WINDOW, 20); // second tap within 400ms
+
+  writeReg(LIS3DH_INT1_CFG, 0x60); // 6D | ZHIE: movement into face up
+  writeReg(LIS3DH_INT1_THS, 44); // 700mg on Z counts as face up
+  writeReg(LIS3DH_INT1_DUR, 8); // held for 160ms
+  writeReg(LIS3DH_CTRL_REG5, readReg(LIS3DH_CTRL_REG5) | 0x08); // LIR_INT1
+
+  writeReg(LIS3DH_CTRL_REG6, 0xC0); // I2_CLICKen | I2_IA1, active high
+  gestureSource(); // drop anything latched while configuring
+}
+
+void TM8_accel::gestureEnd(void) {
+  writeReg(LIS3DH_CTRL_REG6, 0x00);
+  writeReg(LIS3DH_CLICK_CFG, 0x00);
+  writeReg(LIS3DH_INT1_CFG, 0x00);
+  gestureSource();
+}
+
+// both sources are read every time, so both latches are released even when both fired
+uint8_t TM8_accel::gestureSource(void) {
+  uint8_t click = readReg(LIS3DH_CLICK_SRC);
+  uint8_t ia1 = readReg(LIS3DH_INT1_SRC);
+  uint8_t fired = GESTURE_NONE;
+  if (click & 0x60) fired |= GESTURE_DTAP; // IA and DClick
+  if (ia1 & 0x40) fired |= GESTURE_RAISE;
+  return fired;
+}
+
+uint8_t TM8_accel::readReg(uint8_t reg) {
+  uint8_t val = 0;
+  readRegs(reg, &val, 1);
+  return val;
+}
+
+void TM8_accel::writeReg(uint8_t reg, uint8_t val) {
+  wire->beginTransmission(address);
+  wire->write(reg);
+  wire->write(val);
+  wire->endTransmission();
+}
+
+// reads len consecutive registers starting at reg in a single transaction
+uint8_t TM8_accel::readRegs(uint8_t reg, uint8_t *buf, uint8_t len) {
+  wire->beginTransmission(address);
+  wire->write(len > 1 ? reg | LIS3DH_AUTO_INC : reg);
+  if (wire->endTransmission(false)) return 0;
+
+  uint8_t n = wire->requestFrom(address, (size_t)len);
+  for (uint8_t i=0; i<n; i++) {
+    buf[i] = wire->read();
+  }
+  return n;
+}
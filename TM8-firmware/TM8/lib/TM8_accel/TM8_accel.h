@@ -0,0 +1,108 @@
+#ifndef _TM8_ACCEL_H_
+#define _TM8_ACCEL_H_
+
+#include <inttypes.h>
+
+class TwoWire;
+
+//----------------------------------------------------------------------------
+// LIS3DH registers.
+
+#define LIS3DH_CTRL_REG1    0x20
+#define LIS3DH_CTRL_REG2    0x21
+#define LIS3DH_CTRL_REG4    0x23
+#define LIS3DH_CTRL_REG5    0x24
+#define LIS3DH_CTRL_REG6    0x25
+#define LIS3DH_OUT_X_L      0x28
+#define LIS3DH_FIFO_CTRL    0x2E
+#define LIS3DH_FIFO_SRC     0x2F
+#define LIS3DH_INT1_CFG     0x30
+#define LIS3DH_INT1_SRC     0x31
+#define LIS3DH_INT1_THS     0x32
+#define LIS3DH_INT1_DUR     0x33
+#define LIS3DH_CLICK_CFG    0x38
+#define LIS3DH_CLICK_SRC    0x39
+#define LIS3DH_CLICK_THS    0x3A
+#define LIS3DH_TIME_LIMIT   0x3B
+#define LIS3DH_TIME_LATENCY 0x3C
+#define LIS3DH_TIME_WINDOW  0x3D
+#define LIS3DH_AUTO_INC     0x80 // MSB of sub-address enables register auto-increment
+
+//----------------------------------------------------------------------------
+// Output data rates (CTRL_REG1 ODR[3:0]).
+
+#define ACCEL_ODR_OFF   0x0
+#define ACCEL_ODR_1     0x1
+#define ACCEL_ODR_10    0x2
+#define ACCEL_ODR_25    0x3
+#define ACCEL_ODR_50    0x4
+#define ACCEL_ODR_100   0x5
+#define ACCEL_ODR_200   0x6
+#define ACCEL_ODR_400   0x7
+#define ACCEL_ODR_1600  0x8 // low power mode only
+#define ACCEL_ODR_1344  0x9 // normal/HR mode. 5376Hz in low power mode
+
+// Resolution modes
+#define ACCEL_MODE_LP   0 // 8 bit
+#define ACCEL_MODE_NORM 1 // 10 bit
+#define ACCEL_MODE_HR   2 // 12 bit
+
+#define ACCEL_FIFO_DEPTH 32
+
+// Wake gestures, gestureSource() returns them or'd together
+#define GESTURE_NONE    0
+#define GESTURE_RAISE   1 // face turned up and held (6D movement)
+#define GESTURE_DTAP    2 // double tap on any axis
+
+//----------------------------------------------------------------------------
+
+struct TM8_accelSample
+{
+  int16_t x; // milli-g
+  int16_t y;
+  int16_t z;
+};
+
+// FIFO consumer, gets every drained batch oldest sample first
+typedef void (*TM8_accelBatchFn)(const TM8_accelSample *batch, uint8_t n);
+
+class TM8_accel
+{
+public:
+  TM8_accel(TwoWire *bus, uint8_t addr);
+
+  bool begin(uint8_t rate = ACCEL_ODR_50, uint8_t range = 2, uint8_t mode = ACCEL_MODE_HR);
+  bool read(TM8_accelSample &s); // all three axes in one auto-incremented transaction
+  void convert(const uint8_t *raw, TM8_accelSample &s); // 6 bytes OUT_X_L..OUT_Z_H -> milli-g
+
+  bool fifoBegin(uint8_t watermark, TM8_accelBatchFn consumer);
+  void fifoEnd(void);
+  uint8_t fifoDrain(TM8_accelSample *buf); // whole FIFO in one burst, returns sample count
+  uint8_t service(void); // drains and hands the batch to the consumer once the watermark is hit
+  bool fifoReady(void); // watermark or overrun flag, one register read
+  void sleepUntilBatch(void);
+  uint32_t batchPeriod(void); // ms for the FIFO to fill up to the watermark
+  uint16_t odrHz(void);
+  void powerDown(void); // ODR off, about 0.5uA. begin() or gestureBegin() brings it back
+
+  void gestureBegin(void); // arms double tap and raise detection on INT2
+  void gestureEnd(void);
+  uint8_t gestureSource(void); // GESTURE_ bits for what fired, also releases the latched INT2
+
+  uint8_t readReg(uint8_t reg);
+  void writeReg(uint8_t reg, uint8_t val);
+  uint8_t readRegs(uint8_t reg, uint8_t *buf, uint8_t len);
+
+private:
+  TwoWire *wire;
+  uint8_t address;
+  uint8_t shift; // left-justified data, 8/10/12 significant bits
+  uint8_t mgPerDigit;
+  uint8_t odr;
+  uint8_t fifoWatermark;
+  TM8_accelBatchFn onBatch;
+};
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_ACCEL_H_
@@ -0,0 +1,53 @@
+#ifndef _TM8_APPS_H_
+#define _TM8_APPS_H_
+
+#include <inttypes.h>
+
+#include "TM8_util.h"
+
+//----------------------------------------------------------------------------
+// Peripherals an app needs powered while it runs.
+
+#define APP_USES_ACCEL    0x01 // LIS3DH
+#define APP_USES_BME      0x02 // BME680
+#define APP_USES_FUEL     0x04 // MAX17048 readings beyond the cached percent
+#define APP_USES_EEPROM   0x08
+#define APP_USES_USB      0x10 // Serial, HID
+#define APP_USES_LEDS     0x20
+#define APP_USES_PIEZO    0x40
+#define APP_USES_LIGHT    0x80 // flashlight LED
+#define APP_USES_CPU      0x100 // wants the full 48MHz, see TM8_clock
+
+// preferred display refresh, ms. 0 means the app draws as fast as it can
+#define APP_REFRESH_FAST  0
+
+//----------------------------------------------------------------------------
+
+typedef void (*TM8_appFn)(void);
+
+/*
+Main menu entry. Everything is known at compile time so the whole table
+sits in flash, and the name is already in segment form.
+*/
+struct TM8_app
+{
+  TM8_lcdText name;
+  TM8_appFn entry; // 0 for entries that only return to the home screen
+  uint16_t uses; // APP_USES_* bits
+  uint16_t refreshMs;
+};
+
+// lets apps keep whatever return type they have, the menu ignores it
+template <typename R, R (*fn)(void)>
+void appEntry(void) {
+  fn();
+}
+
+#define TM8_APP(name, fn, uses, refreshMs) \
+  {lcdText(name), &appEntry<decltype(fn()), fn>, uses, refreshMs}
+#define TM8_APP_NONE(name) \
+  {lcdText(name), 0, 0, 0}
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_APPS_H_
@@ -0,0 +1,99 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "Wire.h"
+
+#include "TM8_battery.h"
+
+#include <Arduino.h>
+#include <Adafruit_MAX1704X.h>
+
+//----------------------------------------------------------------------------
+
+/*
+MAX17048 register map, only what the library doesn't already expose
+*/
+#define MAX17048_ADDR   0x36
+#define REG_CONFIG      0x0C
+#define CONFIG_ALSC     0x0040 // alert on every 1% SoC change
+#define CONFIG_ALRT     0x0020 // alert status bit, holds ALRT low until cleared
+
+bool TM8_battery::begin(Adafruit_MAX17048 *gauge, TwoWire *bus, uint8_t alertPin) {
+  fuel = gauge;
+  wire = bus;
+  alrtPin = alertPin;
+  alertPending = false;
+
+  pinMode(alrtPin, INPUT_PULLUP); // ALRT is open drain, active low
+
+  fuel->setAlertVoltages(BATT_LOW_VOLTS, BATT_HIGH_VOLTS);
+  // let the gauge drop into hibernate on its own while the watch is sleeping
+  // hibernate samples every 45s instead of 250ms
+  fuel->setHibernationThreshold(BATT_HIB_THRESH);
+  fuel->setActivityThreshold(BATT_ACT_THRESH);
+
+  uint16_t config = readReg(REG_CONFIG);
+  writeReg(REG_CONFIG, (config | CONFIG_ALSC) & ~CONFIG_ALRT);
+
+  refresh(0);
+  return mv != 0;
+}
+
+/*
+cheap enough to call on every loop. only touches the bus when
+ALRT fired or the cache went stale
+*/
+void TM8_battery::update(uint32_t now) {
+  if (alertPending || !digitalRead(alrtPin) || now - lastRead >= BATT_REFRESH_SECS) {
+    refresh(now);
+  }
+}
+
+void TM8_battery::refresh(uint32_t now) {
+  alertPending = false;
+  lastRead = now;
+
+  float pct = fuel->cellPercent();
+  if (pct < 0) pct = 0;
+  if (pct > 99) pct = 99;
+  soc = (uint8_t)pct;
+  mv = (uint16_t)(fuel->cellVoltage() * 1000);
+
+  uint8_t flags = fuel->getAlertStatus();
+  low = (flags & MAX1704X_ALERTFLAG_VOLTAGE_LOW) || mv < BATT_LOW_VOLTS * 1000;
+
+  // release ALRT so the next SoC step can pull it low again
+  if (flags) fuel->clearAlertFlag(flags);
+  uint16_t config = readReg(REG_CONFIG);
+  if (config & CONFIG_ALRT) writeReg(REG_CONFIG, config & ~CONFIG_ALRT);
+}
+
+/*
+power manager hooks (PWR_FUEL). the watch only needs 1% steps, which the gauge
+still reports from hibernate, so it stays there unless something holds it awake
+*/
+void TM8_battery::hibernate(void) {
+  fuel->hibernate();
+}
+
+void TM8_battery::wake(void) {
+  fuel->wake();
+}
+
+uint16_t TM8_battery::readReg(uint8_t reg) {
+  wire->beginTransmission(MAX17048_ADDR);
+  wire->write(reg);
+  wire->endTransmission(false);
+  if (wire->requestFrom(MAX17048_ADDR, 2) != 2) return 0;
+  uint16_t val = wire->read() << 8;
+  return val | wire->read();
+}
+
+void TM8_battery::writeReg(uint8_t reg, uint16_t val) {
+  wire->beginTransmission(MAX17048_ADDR);
+  wire->write(reg);
+  wire->write(val >> 8);
+  wire->write(val & 0xFF);
+  wire->endTransmission();
+}
@@ -0,0 +1,55 @@
+#ifndef _TM8_BATTERY_H_
+#define _TM8_BATTERY_H_
+
+#include <inttypes.h>
+
+class TwoWire;
+class Adafruit_MAX17048;
+
+//----------------------------------------------------------------------------
+
+#define BATT_REFRESH_SECS   300   // re-read the gauge at least this often (RTC seconds)
+#define BATT_LOW_VOLTS      3.40  // ALRT fires below this cell voltage
+#define BATT_HIGH_VOLTS     4.30  // ALRT fires above this cell voltage
+#define BATT_HIB_THRESH     4.0   // %/hr. gauge hibernates when |CRATE| stays below this
+#define BATT_ACT_THRESH     0.08  // V. gauge wakes from hibernate when the cell moves this much
+
+//----------------------------------------------------------------------------
+
+/*
+Cached MAX17048 state.
+SoC and voltage are read over I2C only on begin(), when the gauge pulls ALRT low
+(1% SoC change, low/high voltage) or when the cached value is older than BATT_REFRESH_SECS.
+Everything else (UI, app checks) reads the cache and never touches the bus.
+*/
+class TM8_battery
+{
+public:
+  bool begin(Adafruit_MAX17048 *gauge, TwoWire *bus, uint8_t alertPin);
+  void update(uint32_t now); // now is RTC epoch seconds, keeps working across deep sleep
+  void refresh(uint32_t now); // unconditional read, also acknowledges the ALRT pin
+  void hibernate(void); // forced hibernate, samples every 45s, ALRT keeps working
+  void wake(void); // 250ms sampling until the next hibernate()
+
+  uint8_t percent(void) { return soc; } // clamped to 0-99 so it fits two LCD digits
+  uint16_t millivolts(void) { return mv; }
+  bool isLow(void) { return low; }
+
+  volatile bool alertPending; // set from the ALRT ISR
+
+private:
+  uint16_t readReg(uint8_t reg);
+  void writeReg(uint8_t reg, uint16_t val);
+
+  Adafruit_MAX17048 *fuel;
+  TwoWire *wire;
+  uint8_t alrtPin;
+  uint8_t soc;
+  uint16_t mv;
+  bool low;
+  uint32_t lastRead;
+};
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_BATTERY_H_
@@ -0,0 +1,68 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_boot.h"
+
+#include <Arduino.h>
+
+//----------------------------------------------------------------------------
+
+#define BOOT_IDLE   0xFF // nothing in flight on this bus
+
+TM8_boot Boot;
+
+const TM8_bootDevice bootDevices[BOOT_DEVICES] =
+{
+  {BOOT_BUS_WIRE, 0x38, "LCDL"},
+  {BOOT_BUS_WIRE1, 0x38, "LCDR"},
+  {BOOT_BUS_WIRE, 0x36, "FUEL"},
+  {BOOT_BUS_WIRE1, 0x18, "ACCL"},
+  {BOOT_BUS_WIRE1, 0x76, "TEMP"},
+  {BOOT_BUS_WIRE1, 0x50, "ROM "},
+};
+
+static Sercom *const busHw[BOOT_BUSES] = {SERCOM3, SERCOM2};
+
+static void stopBus(Sercom *s) {
+  s->I2CM.CTRLB.reg |= SERCOM_I2CM_CTRLB_CMD(3); // STOP
+  while (s->I2CM.SYNCBUSY.reg & SERCOM_I2CM_SYNCBUSY_SYSOP);
+}
+
+uint8_t TM8_boot::probe(void) {
+  uint8_t todo = BOOT_DEV_ALL;
+  uint8_t at[BOOT_BUSES];
+  uint32_t since[BOOT_BUSES];
+  bool busy;
+
+  found = 0;
+  for (uint8_t b=0; b<BOOT_BUSES; b++) at[b] = BOOT_IDLE;
+
+  do {
+    busy = false;
+    for (uint8_t b=0; b<BOOT_BUSES; b++) {
+      Sercom *s = busHw[b];
+      if (at[b] == BOOT_IDLE) { // start this bus' next device
+        for (uint8_t i=0; i<BOOT_DEVICES; i++) {
+          if (!(todo & (1 << i)) || bootDevices[i].bus != b) continue;
+          todo &= ~(1 << i);
+          at[b] = i;
+          since[b] = micros();
+          s->I2CM.ADDR.reg = bootDevices[i].address << 1; // write, the address goes out on its own
+          break;
+        }
+        if (at[b] == BOOT_IDLE) continue; // this bus is done
+      }
+
+      busy = true;
+      bool done = s->I2CM.INTFLAG.reg & (SERCOM_I2CM_INTFLAG_MB | SERCOM_I2CM_INTFLAG_SB);
+      if (!done && micros() - since[b] < BOOT_PROBE_US) continue;
+      uint16_t bad = SERCOM_I2CM_STATUS_RXNACK | SERCOM_I2CM_STATUS_ARBLOST | SERCOM_I2CM_STATUS_BUSERR;
+      if (done && !(s->I2CM.STATUS.reg & bad)) found |= 1 << at[b];
+      stopBus(s);
+      at[b] = BOOT_IDLE;
+    }
+  } while (busy || todo);
+
+  return found;
+}
@@ -0,0 +1,65 @@
+#ifndef _TM8_BOOT_H_
+#define _TM8_BOOT_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+#define BOOT_BUS_WIRE     0 // SERCOM3: left LCD, MAX17048
+#define BOOT_BUS_WIRE1    1 // SERCOM2: right LCD, LIS3DH, BME680, EEPROM
+#define BOOT_BUSES        2
+
+// bits of a device map, in bootDevices[] order
+#define BOOT_DEV_LCDL     0x01
+#define BOOT_DEV_LCDR     0x02
+#define BOOT_DEV_FUEL     0x04
+#define BOOT_DEV_ACCEL    0x08
+#define BOOT_DEV_BME      0x10
+#define BOOT_DEV_ROM      0x20
+#define BOOT_DEVICES      6
+#define BOOT_DEV_ALL      0x3F
+
+#define BOOT_PROBE_US     2000 // per address, a healthy chip answers in ~100us at 100kHz
+#define BOOT_CACHE_MAGIC  0x5B
+
+//----------------------------------------------------------------------------
+
+struct TM8_bootDevice
+{
+  uint8_t bus;
+  uint8_t address;
+  const char *name; // 4 characters for the LCD
+};
+
+extern const TM8_bootDevice bootDevices[BOOT_DEVICES];
+
+// what the last boot found, kept in the EEPROM next to the settings
+struct TM8_bootCache
+{
+  uint8_t magic; // BOOT_CACHE_MAGIC
+  uint8_t devices;
+};
+
+/*
+Power-on self test.
+probe() addresses every device in bootDevices[] with an empty write and
+collects the ACKs. Both buses run at once: the SERCOMs clock the address out by
+themselves, so one of each bus' devices is started and the pair is polled
+together, and the whole map is in well under a millisecond on healthy
+hardware. A device that doesn't answer within BOOT_PROBE_US counts as missing.
+It runs before the sensor libraries touch the buses, straight on the SERCOM
+registers, and leaves both buses idle.
+*/
+class TM8_boot
+{
+public:
+  uint8_t probe(void); // returns the device map, also kept in found
+
+  uint8_t found;
+};
+
+extern TM8_boot Boot;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_BOOT_H_
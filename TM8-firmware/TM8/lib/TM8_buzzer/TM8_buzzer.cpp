@@ -0,0 +1,202 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_buzzer.h"
+
+#include <Arduino.h>
+#include "wiring_private.h" // pinPeripheral()
+#include <TM8_clock.h>
+
+//----------------------------------------------------------------------------
+
+#define BUZZER_CLOCK_HZ 8000000 // GCLK3, OSC8M undivided
+#define BUZZER_TICK_HZ  1024 // TC4 runs off RTCZero's 1024Hz XOSC32K generator
+
+TM8_buzzer Buzzer;
+
+const TM8_note cueError[] = {{4000, 100}, {0, 100}, {4000, 100}, {0, 100}, {4000, 100}, NOTE_END};
+const TM8_note cueAlarm[] = {{2000, 80}, {4000, 120}, {0, 150}, {2000, 80}, {4000, 120}, NOTE_END};
+
+static void tccSync(void) {
+  while (TCC1->SYNCBUSY.reg);
+}
+
+static void tcSync(void) {
+  while (TC4->COUNT16.STATUS.bit.SYNCBUSY);
+}
+
+static void gclkSync(void) {
+  while (GCLK->STATUS.bit.SYNCBUSY);
+}
+
+void TM8_buzzer::begin(uint8_t pin) {
+  port = g_APinDescription[pin].ulPort;
+  pinNum = g_APinDescription[pin].ulPin;
+  queued = 0;
+  playing = false;
+
+  PM->APBCMASK.reg |= PM_APBCMASK_TCC1 | PM_APBCMASK_TC4;
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK3 | GCLK_CLKCTRL_ID_TCC0_TCC1;
+  gclkSync();
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK2 | GCLK_CLKCTRL_ID_TC4_TC5;
+  gclkSync();
+
+  TCC1->CTRLA.reg = TCC_CTRLA_SWRST;
+  while (TCC1->CTRLA.bit.SWRST);
+  TCC1->CTRLA.reg = TCC_CTRLA_PRESCALER_DIV1 | TCC_CTRLA_RUNSTDBY;
+  TCC1->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
+  tccSync();
+
+  TC4->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+  while (TC4->COUNT16.CTRLA.bit.SWRST);
+  TC4->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV1 | TC_CTRLA_RUNSTDBY;
+  tcSync();
+  TC4->COUNT16.CTRLBSET.reg = TC_CTRLBSET_ONESHOT;
+  tcSync();
+  TC4->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+  NVIC_SetPriority(TC4_IRQn, 3);
+  NVIC_EnableIRQ(TC4_IRQn);
+
+  // low GPIO while quiet, the mux only goes over to TCC1 while a note sounds
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+  pinPeripheral(pin, PIO_TIMER);
+  PORT->Group[port].PINCFG[pinNum].reg &= ~PORT_PINCFG_PMUXEN;
+}
+
+/*
+an equal or higher priority sequence cuts off the one playing, so repeated
+tone() calls just retune (the starter's rev sweep). a lower one waits its turn
+in the queue, behind a held tone it waits until stop()
+*/
+bool TM8_buzzer::play(const TM8_note *seq, uint8_t priority) {
+  TM8_buzzerSlot s;
+  s.seq = seq;
+  s.priority = priority;
+  return enqueue(s);
+}
+
+bool TM8_buzzer::tone(uint16_t hz, uint16_t ms, uint8_t priority) {
+  TM8_buzzerSlot s;
+  s.seq = 0;
+  s.one[0].hz = hz;
+  s.one[0].ms = ms;
+  s.one[1].hz = 0;
+  s.one[1].ms = 0;
+  s.priority = priority;
+  return enqueue(s);
+}
+
+void TM8_buzzer::stop(void) {
+  noInterrupts();
+  stopTimer();
+  queued = 0;
+  playing = false;
+  silence();
+  interrupts();
+}
+
+// steps to the next note, or the next queued sequence once this one is over
+void TM8_buzzer::next(void) {
+  while (playing) {
+    TM8_note n = *at;
+    if (n.hz || n.ms) {
+      at++;
+      n.hz ? sound(n.hz) : silence();
+      if (n.ms) startTimer(n.ms); // no timer for NOTE_HOLD, it sounds until stop()
+      return;
+    }
+    if (dequeue(cur)) at = cur.seq ? cur.seq : cur.one;
+    else playing = false;
+  }
+  silence();
+}
+
+bool TM8_buzzer::enqueue(const TM8_buzzerSlot &s) {
+  bool ok = true;
+  noInterrupts();
+  if (!playing || s.priority >= cur.priority) {
+    stopTimer();
+    cur = s;
+    at = cur.seq ? cur.seq : cur.one;
+    playing = true;
+    next();
+  } else if (queued < BUZZER_QUEUE) {
+    queue[queued++] = s;
+  } else { // full, bump the oldest of the lowest priority if the new one outranks it
+    uint8_t low = 0;
+    for (uint8_t i=1; i<queued; i++) {
+      if (queue[i].priority < queue[low].priority) low = i;
+    }
+    if (s.priority > queue[low].priority) {
+      for (uint8_t i=low; i<queued-1; i++) queue[i] = queue[i + 1];
+      queue[queued - 1] = s;
+    } else {
+      ok = false;
+    }
+  }
+  interrupts();
+  return ok;
+}
+
+// highest priority first, oldest first within a priority
+bool TM8_buzzer::dequeue(TM8_buzzerSlot &s) {
+  if (!queued) return false;
+  uint8_t high = 0;
+  for (uint8_t i=1; i<queued; i++) {
+    if (queue[i].priority > queue[high].priority) high = i;
+  }
+  s = queue[high];
+  queued--;
+  for (uint8_t i=high; i<queued; i++) queue[i] = queue[i + 1];
+  return true;
+}
+
+void TM8_buzzer::sound(uint16_t hz) {
+  uint32_t per = BUZZER_CLOCK_HZ / hz - 1;
+  TCC1->PER.reg = per;
+  TCC1->CC[1].reg = (per + 1) / 2; // 50% duty, loudest for a piezo
+  tccSync();
+  if (TCC1->CTRLA.bit.ENABLE) {
+    TCC1->CTRLBSET.reg = TCC_CTRLBSET_CMD_RETRIGGER; // the count may already be past the new PER
+  } else {
+    Clock.holdOsc8m(true); // a note carries on into STANDBY
+    TCC1->CTRLA.bit.ENABLE = 1;
+    PORT->Group[port].PINCFG[pinNum].reg |= PORT_PINCFG_PMUXEN;
+  }
+  tccSync();
+}
+
+void TM8_buzzer::silence(void) {
+  PORT->Group[port].PINCFG[pinNum].reg &= ~PORT_PINCFG_PMUXEN;
+  if (!TCC1->CTRLA.bit.ENABLE) return;
+  TCC1->CTRLA.bit.ENABLE = 0;
+  tccSync();
+  Clock.holdOsc8m(false);
+}
+
+void TM8_buzzer::startTimer(uint16_t ms) {
+  uint32_t ticks = (uint32_t)ms * BUZZER_TICK_HZ / 1000;
+  if (!ticks) ticks = 1;
+  if (ticks > 0xFFFF) ticks = 0xFFFF;
+  TC4->COUNT16.COUNT.reg = 0;
+  tcSync();
+  TC4->COUNT16.CC[0].reg = ticks;
+  tcSync();
+  TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  TC4->COUNT16.CTRLA.bit.ENABLE = 1;
+  tcSync();
+}
+
+void TM8_buzzer::stopTimer(void) {
+  TC4->COUNT16.CTRLA.bit.ENABLE = 0;
+  tcSync();
+  TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  NVIC_ClearPendingIRQ(TC4_IRQn);
+}
+
+void TC4_Handler(void) {
+  TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  Buzzer.next();
+}
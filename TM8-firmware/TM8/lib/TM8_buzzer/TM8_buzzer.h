@@ -0,0 +1,85 @@
+#ifndef _TM8_BUZZER_H_
+#define _TM8_BUZZER_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+#define BUZZER_QUEUE    4 // sequences waiting behind a higher priority one
+
+// priorities, an equal or higher one cuts off whatever is playing
+#define BUZZER_PRI_CLICK  0 // key clicks
+#define BUZZER_PRI_UI     1 // app sounds, animations
+#define BUZZER_PRI_ALARM  2 // timers, alarms, errors
+
+#define NOTE_HOLD   0 // tone() length that plays until stop()
+
+//----------------------------------------------------------------------------
+
+/*
+one step of a sequence. hz 0 is a rest, {0, 0} ends the sequence.
+sequences are plain const arrays, so they stay in flash
+*/
+struct TM8_note
+{
+  uint16_t hz;
+  uint16_t ms;
+};
+
+#define NOTE_END  {0, 0}
+
+extern const TM8_note cueError[]; // three short 4kHz beeps
+extern const TM8_note cueAlarm[]; // two rising chirps
+
+struct TM8_buzzerSlot
+{
+  const TM8_note *seq; // 0: plays one[]
+  TM8_note one[2]; // a single tone() note and its NOTE_END
+  uint8_t priority;
+};
+
+/*
+Interrupt driven piezo.
+TCC1 makes the square wave on WO[1] (PA07, D9) by itself, clocked from GCLK3
+(OSC8M, 8MHz) so the pitch doesn't move with the core clock profile. TC4 on the
+RTC's 1024Hz GCLK2 times each note and its interrupt starts the next one, so
+a melody costs one interrupt per note and the CPU is free to sleep or run UI.
+Both run in STANDBY, OSC8M is only held for STANDBY while a note sounds.
+TC4 shares its clock selection with TC5, so Arduino's tone() can't be used
+alongside this.
+*/
+class TM8_buzzer
+{
+public:
+  void begin(uint8_t pin); // pin has to be D9, nothing else on TM8 is TCC1/WO[1]
+
+  bool play(const TM8_note *seq, uint8_t priority = BUZZER_PRI_UI); // false if it was dropped
+  bool tone(uint16_t hz, uint16_t ms = NOTE_HOLD, uint8_t priority = BUZZER_PRI_UI);
+  void stop(void); // silence, and forget anything queued
+  bool busy(void) { return playing; }
+
+  void next(void); // TC4 interrupt, the current note is over
+
+private:
+  bool enqueue(const TM8_buzzerSlot &s);
+  bool dequeue(TM8_buzzerSlot &s);
+  void sound(uint16_t hz);
+  void silence(void);
+  void startTimer(uint16_t ms);
+  void stopTimer(void);
+
+  uint8_t port;
+  uint8_t pinNum; // PORT group and pin, for switching the mux on and off
+
+  TM8_buzzerSlot queue[BUZZER_QUEUE]; // oldest first
+  uint8_t queued;
+  TM8_buzzerSlot cur;
+  const TM8_note *at; // next note of cur
+  volatile bool playing;
+};
+
+extern TM8_buzzer Buzzer;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_BUZZER_H_
@@ -0,0 +1,124 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_clock.h"
+
+#include <Arduino.h>
+#include <TM8_power.h>
+
+//----------------------------------------------------------------------------
+
+TM8_clock Clock;
+
+static const uint32_t profileHz[3] = {48000000, 8000000, 1000000};
+
+static void gclkSync(void) {
+  while (GCLK->STATUS.bit.SYNCBUSY);
+}
+
+static void dfllSync(void) {
+  while (!(SYSCTRL->PCLKSR.reg & SYSCTRL_PCLKSR_DFLLRDY));
+}
+
+static uint32_t scaleFor(uint32_t hz) {
+  return (1000UL << 16) / (hz / 1000);
+}
+
+void TM8_clock::begin(void) {
+  current = CLOCK_48MHZ;
+  dfllCtrl = SYSCTRL->DFLLCTRL.reg; // closed loop, WAITLOCK, QLDIS from SystemInit()
+  osc8mHolds = 0;
+  usScale = scaleFor(profileHz[current]);
+
+  // the core already runs GCLK3 off OSC8M. RUNSTDBY here costs nothing by itself,
+  // OSC8M only keeps going in STANDBY while holdOsc8m() says so
+  GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(3) | GCLK_GENCTRL_SRC_OSC8M | GCLK_GENCTRL_GENEN | GCLK_GENCTRL_RUNSTDBY;
+  gclkSync();
+}
+
+uint32_t TM8_clock::hz(void) {
+  return profileHz[current];
+}
+
+/*
+the same reads as the core's micros(): SysTick, its pending bit and millis()
+again until they agree, so a tick in between can't be counted twice or not at
+all. only the scale differs, a multiply instead of a divide so a 1MHz read stays
+cheap
+*/
+uint32_t TM8_clock::micros(void) {
+  uint32_t ticks, ms, pend;
+  uint32_t ticks2 = SysTick->VAL;
+  uint32_t pend2 = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+  uint32_t ms2 = millis();
+  do {
+    ticks = ticks2;
+    pend = pend2;
+    ms = ms2;
+    ticks2 = SysTick->VAL;
+    pend2 = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+    ms2 = millis();
+  } while (pend != pend2 || ms != ms2 || ticks < ticks2);
+  return (ms + (pend ? 1 : 0)) * 1000 + (((SysTick->LOAD - ticks) * usScale) >> 16);
+}
+
+/*
+going up, wait states and the DFLL lock come before GCLK0 moves over.
+going down, GCLK0 moves first so nothing is running off the DFLL when it stops.
+the DFLL keeps DFLLVAL while it's off, so relocking only takes a few ms.
+*/
+bool TM8_clock::set(uint8_t profile) {
+  if (profile == current) return true;
+  if (profile != CLOCK_48MHZ && Power.isOn(PWR_USB)) return false;
+
+  noInterrupts();
+  if (profile == CLOCK_48MHZ) {
+    NVMCTRL->CTRLB.bit.RWS = 1; // one wait state above 24MHz
+    dfllOn();
+    GCLK->GENDIV.reg = GCLK_GENDIV_ID(0) | GCLK_GENDIV_DIV(0);
+    gclkSync();
+    GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(0) | GCLK_GENCTRL_SRC_DFLL48M | GCLK_GENCTRL_IDC | GCLK_GENCTRL_GENEN;
+    gclkSync();
+  } else {
+    GCLK->GENDIV.reg = GCLK_GENDIV_ID(0) | GCLK_GENDIV_DIV(profile == CLOCK_1MHZ ? 8 : 0);
+    gclkSync();
+    GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(0) | GCLK_GENCTRL_SRC_OSC8M | GCLK_GENCTRL_IDC | GCLK_GENCTRL_GENEN;
+    gclkSync();
+    if (current == CLOCK_48MHZ) dfllOff();
+    NVMCTRL->CTRLB.bit.RWS = 0;
+  }
+  current = profile;
+  usScale = scaleFor(profileHz[profile]);
+  SystemCoreClock = profileHz[profile];
+  SysTick_Config(SystemCoreClock / 1000);
+  NVIC_SetPriority(SysTick_IRQn, (1 << __NVIC_PRIO_BITS) - 2); // SysTick_Config() drops it to the lowest, the core's init() runs millis at 2
+  interrupts();
+
+  Power.retime(); // SERCOM baud is computed from SystemCoreClock
+  return true;
+}
+
+/*
+a note that should keep sounding or an LED that should stay dimmed through STANDBY.
+called from the buzzer and LED interrupts too, hence PRIMASK instead of interrupts()
+*/
+void TM8_clock::holdOsc8m(bool hold) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (hold) osc8mHolds++;
+  else if (osc8mHolds) osc8mHolds--;
+  SYSCTRL->OSC8M.bit.RUNSTDBY = osc8mHolds != 0;
+  __set_PRIMASK(primask);
+}
+
+void TM8_clock::dfllOn(void) {
+  SYSCTRL->DFLLCTRL.reg = dfllCtrl;
+  dfllSync();
+  while (!(SYSCTRL->PCLKSR.reg & SYSCTRL_PCLKSR_DFLLLCKC) || !(SYSCTRL->PCLKSR.reg & SYSCTRL_PCLKSR_DFLLLCKF));
+}
+
+void TM8_clock::dfllOff(void) {
+  SYSCTRL->DFLLCTRL.reg = dfllCtrl & ~SYSCTRL_DFLLCTRL_ENABLE;
+  dfllSync();
+}
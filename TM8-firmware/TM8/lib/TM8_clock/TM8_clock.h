@@ -0,0 +1,50 @@
+#ifndef _TM8_CLOCK_H_
+#define _TM8_CLOCK_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+// Core clock profiles (GCLK0).
+
+#define CLOCK_48MHZ 0 // DFLL48M locked to the 32k crystal. USB, HID, FFT
+#define CLOCK_8MHZ  1 // OSC8M, DFLL off. menus and apps
+#define CLOCK_1MHZ  2 // OSC8M / 8, DFLL off. background work between sleeps
+
+//----------------------------------------------------------------------------
+
+/*
+Run time clock switching.
+The core boots on the DFLL at 48MHz, which the watch only needs for USB and
+heavy number crunching. set() moves GCLK0 (CPU, SERCOMs, EIC)
+between the DFLL and OSC8M and fixes up everything that was derived from it:
+flash wait states, SysTick (millis), both I2C baud rates. The buzzer and LED
+PWM run off GCLK3 (OSC8M, 8MHz) and the sleep timer off GCLK2, neither one moves.
+delayMicroseconds() and the sub-ms part of micros() are built on F_CPU in the
+core, so they run long below 48MHz. micros() here scales SysTick by the reload
+set() gave it instead, use it for anything timed in us.
+*/
+class TM8_clock
+{
+public:
+  void begin(void); // remembers the DFLL setup the core left running
+  bool set(uint8_t profile); // refuses to leave 48MHz while USB is held
+  uint8_t profile(void) { return current; }
+  uint32_t hz(void);
+  uint32_t micros(void); // the core's micros(), right in every profile
+  void holdOsc8m(bool hold); // keeps OSC8M (GCLK3) running in STANDBY while anyone holds it
+
+private:
+  void dfllOn(void);
+  void dfllOff(void);
+
+  uint8_t current;
+  uint16_t dfllCtrl;
+  uint32_t usScale; // us per SysTick count, 16.16
+  uint8_t osc8mHolds;
+};
+
+extern TM8_clock Clock;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_CLOCK_H_
@@ -0,0 +1,54 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_events.h"
+
+#include <Arduino.h>
+#include <TM8_sleep.h>
+
+//----------------------------------------------------------------------------
+
+#define EVENT_MASK  (EVENT_RING_LEN - 1)
+
+TM8_events Events;
+
+// RTCZero and attachInterrupt() happen to use 0 as well, this doesn't leave it to them
+void TM8_events::begin(void) {
+  head = tail = 0;
+  overruns = 0;
+  NVIC_SetPriority(EIC_IRQn, 0);
+  NVIC_SetPriority(RTC_IRQn, 0);
+}
+
+bool TM8_events::push(uint8_t type, uint8_t arg) {
+  uint8_t h = head;
+  uint8_t n = (h + 1) & EVENT_MASK;
+  bool ok = n != tail;
+
+  if (ok) {
+    ring[h].type = type;
+    ring[h].arg = arg;
+    ring[h].time = millis();
+    __DMB(); // the slot is complete before the consumer can see it
+    head = n;
+  } else {
+    overruns++;
+  }
+  Sleep.poke(); // wake the loop either way, it has a full ring to drain
+  return ok;
+}
+
+bool TM8_events::next(TM8_event &e) {
+  uint8_t t = tail;
+  if (t == head) return false;
+  __DMB(); // head is read before the slot it published
+  e = ring[t];
+  __DMB(); // done with the slot before the producer may fill it again
+  tail = (t + 1) & EVENT_MASK;
+  return true;
+}
+
+void TM8_events::flush(void) {
+  tail = head;
+}
@@ -0,0 +1,59 @@
+#ifndef _TM8_EVENTS_H_
+#define _TM8_EVENTS_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+#define EVENT_RING_LEN  32 // power of two
+
+// event types
+#define EVENT_BUTTON    1 // raw press edge from an Input.onPress() hook, arg is the button
+#define EVENT_GESTURE   3 // LIS3DH raise or double tap on INT2
+#define EVENT_FUEL      4 // MAX17048 ALRT
+#define EVENT_ALARM     5 // RTC alarm, Timers has something due
+
+//----------------------------------------------------------------------------
+
+struct TM8_event
+{
+  uint8_t type;
+  uint8_t arg;
+  uint32_t time; // millis() in the ISR
+};
+
+/*
+ISR to main loop event ring.
+The EIC and RTC interrupts push, the main loop pops, each in order and with
+the time it happened. Single producer, single consumer and no locks: begin()
+puts both interrupts on the same NVIC priority so they can't preempt each
+other, which makes the ISR side one producer. Only the producer writes head
+and only the consumer writes tail; a barrier between filling a slot and
+publishing it (and between reading a slot and giving it back) keeps the
+compiler and the bus from reordering the two.
+Every push pokes the sleep governor, so the main loop sleeps until there is
+something in the ring instead of polling flags.
+*/
+class TM8_events
+{
+public:
+  void begin(void);
+
+  bool push(uint8_t type, uint8_t arg = 0); // ISR side only, false if the ring was full
+  bool next(TM8_event &e); // main loop only, pops the oldest
+  bool pending(void) { return head != tail; }
+  void flush(void); // main loop only, e.g. presses that belonged to an app that just ended
+
+  volatile uint16_t overruns; // pushes lost to a full ring
+
+private:
+  TM8_event ring[EVENT_RING_LEN];
+  volatile uint8_t head; // next slot to fill, producer owned
+  volatile uint8_t tail; // oldest unread slot, consumer owned
+};
+
+extern TM8_events Events;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_EVENTS_H_
@@ -0,0 +1,130 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_fft.h"
+
+//----------------------------------------------------------------------------
+
+// sin(2*pi*k/256) in Q15, first quadrant only
+static const int16_t quarterSine[FFT_N / 4 + 1] =
+{
+       0,    804,   1608,   2411,   3212,   4011,   4808,   5602,
+    6393,   7180,   7962,   8740,   9512,  10279,  11039,  11793,
+   12540,  13279,  14010,  14733,  15447,  16151,  16846,  17531,
+   18205,  18868,  19520,  20160,  20788,  21403,  22006,  22595,
+   23170,  23732,  24279,  24812,  25330,  25833,  26320,  26791,
+   27246,  27684,  28106,  28511,  28899,  29269,  29622,  29957,
+   30274,  30572,  30853,  31114,  31357,  31581,  31786,  31972,
+   32138,  32286,  32413,  32522,  32610,  32679,  32729,  32758,
+   32767,
+};
+
+static int16_t fftSin(uint16_t k) {
+  k &= FFT_N - 1;
+  if (k <= FFT_N / 4) return quarterSine[k];
+  if (k <= FFT_N / 2) return quarterSine[FFT_N / 2 - k];
+  if (k <= FFT_N * 3 / 4) return -quarterSine[k - FFT_N / 2];
+  return -quarterSine[FFT_N - k];
+}
+
+static uint8_t bitReverse(uint8_t v) {
+  v = (v & 0xF0) >> 4 | (v & 0x0F) << 4;
+  v = (v & 0xCC) >> 2 | (v & 0x33) << 2;
+  v = (v & 0xAA) >> 1 | (v & 0x55) << 1;
+  return v;
+}
+
+/*
+decimation in time. bit reversal first, then log2(N) stages of butterflies
+with a >>1 on every output
+*/
+void fftReal(int16_t *re, int16_t *im) {
+  for (uint16_t i=0; i<FFT_N; i++) {
+    im[i] = 0;
+    uint8_t j = bitReverse(i);
+    if (j > i) {
+      int16_t t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+    }
+  }
+
+  for (uint16_t size=2, step=FFT_N/2; size<=FFT_N; size<<=1, step>>=1) {
+    uint16_t half = size >> 1;
+    for (uint16_t j=0; j<half; j++) {
+      int32_t wr = fftSin(j * step + FFT_N / 4); // cos
+      int32_t wi = -fftSin(j * step);
+      for (uint16_t a=j; a<FFT_N; a+=size) {
+        uint16_t b = a + half;
+        int32_t tr = (wr * re[b] - wi * im[b]) >> 15;
+        int32_t ti = (wr * im[b] + wi * re[b]) >> 15;
+        re[b] = (re[a] - tr) >> 1;
+        im[b] = (im[a] - ti) >> 1;
+        re[a] = (re[a] + tr) >> 1;
+        im[a] = (im[a] + ti) >> 1;
+      }
+    }
+  }
+}
+
+/*
+block floating point: subtract the mean and shift everything up until the
+biggest sample is over half scale, so the 8 halving stages don't eat small vibrations
+*/
+uint16_t fftPrepare(const int16_t *in, int16_t *re) {
+  int32_t sum = 0;
+  for (uint16_t i=0; i<FFT_N; i++) sum += in[i];
+  int16_t mean = sum >> FFT_LOG2N;
+
+  int16_t peak = 0;
+  for (uint16_t i=0; i<FFT_N; i++) {
+    int16_t v = in[i] - mean;
+    re[i] = v;
+    if (v < 0) v = -v;
+    if (v > peak) peak = v;
+  }
+
+  uint16_t shift = 0;
+  while (peak && peak < 8192) {
+    peak <<= 1;
+    shift++;
+  }
+  for (uint16_t i=0; i<FFT_N; i++) re[i] <<= shift;
+  return shift;
+}
+
+/*
+strongest bin between minBin and maxBin (inclusive, both within 1..N/2-2),
+refined with a parabola through its neighbours. returns bin * 256
+*/
+uint32_t fftPeak(const int16_t *re, const int16_t *im, uint16_t minBin, uint16_t maxBin) {
+  uint32_t power[3] = {0, 0, 0};
+  uint32_t best = 0;
+  uint16_t bin = 0;
+
+  for (uint16_t k=minBin; k<=maxBin; k++) {
+    uint32_t p = (int32_t)re[k] * re[k] + (int32_t)im[k] * im[k];
+    if (p > best) {
+      best = p;
+      bin = k;
+    }
+  }
+  if (!bin) return 0;
+
+  for (uint8_t i=0; i<3; i++) {
+    uint16_t k = bin - 1 + i;
+    power[i] = (int32_t)re[k] * re[k] + (int32_t)im[k] * im[k];
+  }
+  // offset = (p0 - p2) / (2 * (p0 - 2 p1 + p2)), somewhere in -0.5..0.5 when p1 is a real maximum.
+  // at minBin/maxBin the neighbour outside the range can be the bigger one: the parabola
+  // then opens upwards (den <= 0) or overshoots, either way the peak is past the half bin
+  int64_t num = ((int64_t)power[2] - power[0]) * 128;
+  int64_t den = 2 * (int64_t)power[1] - power[0] - power[2];
+  int32_t offset;
+  if (den > 0) offset = num / den;
+  else offset = power[2] > power[0] ? 128 : -128;
+  if (offset > 128) offset = 128;
+  if (offset < -128) offset = -128;
+  return ((uint32_t)bin << 8) + offset;
+}
@@ -0,0 +1,25 @@
+#ifndef _TM8_FFT_H_
+#define _TM8_FFT_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+#define FFT_N       256
+#define FFT_LOG2N   8
+
+//----------------------------------------------------------------------------
+
+/*
+Q15 fixed point radix-2 FFT for the M0+: no FPU and no divider, but a single
+cycle 32x32 multiply, so everything is int16 data with int32 products.
+Each stage halves the data so nothing overflows, the output is X[k] / FFT_N.
+No Arduino dependencies.
+*/
+void fftReal(int16_t *re, int16_t *im); // in place, im is scratch on input
+uint16_t fftPrepare(const int16_t *in, int16_t *re); // removes DC and normalises, returns the gain shift
+uint32_t fftPeak(const int16_t *re, const int16_t *im, uint16_t minBin, uint16_t maxBin); // Q8 bin of the strongest peak
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_FFT_H_
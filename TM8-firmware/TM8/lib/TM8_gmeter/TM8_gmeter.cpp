@@ -0,0 +1,46 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+#include <math.h>
+
+#include "TM8_gmeter.h"
+
+//----------------------------------------------------------------------------
+
+static void axisReset(TM8_axisStats &a) {
+  a.min = INT16_MAX;
+  a.max = INT16_MIN;
+  a.sumSq = 0;
+}
+
+static void axisFeed(TM8_axisStats &a, int16_t v) {
+  if (v < a.min) a.min = v;
+  if (v > a.max) a.max = v;
+  a.sumSq += (int32_t)v * v;
+}
+
+void TM8_gmeter::reset(void) {
+  axisReset(lat);
+  axisReset(lon);
+  samples = 0;
+}
+
+void TM8_gmeter::feed(const TM8_accelSample *batch, uint8_t n) {
+  for (uint8_t i=0; i<n; i++) {
+    axisFeed(lat, batch[i].x);
+    axisFeed(lon, batch[i].y);
+  }
+  samples += n;
+}
+
+uint16_t TM8_gmeter::peak(const TM8_axisStats &a) {
+  if (!samples) return 0;
+  int32_t lo = -(int32_t)a.min;
+  return lo > a.max ? lo : a.max;
+}
+
+// only called once per split, so the float sqrt doesn't matter
+uint16_t TM8_gmeter::rms(const TM8_axisStats &a) {
+  if (!samples) return 0;
+  return sqrtf((float)(a.sumSq / samples));
+}
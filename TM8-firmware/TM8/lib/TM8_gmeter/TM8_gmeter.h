@@ -0,0 +1,38 @@
+#ifndef _TM8_GMETER_H_
+#define _TM8_GMETER_H_
+
+#include <inttypes.h>
+
+#include <TM8_accel.h>
+
+//----------------------------------------------------------------------------
+
+/*
+Running G statistics for one lap: min, max and sum of squares per axis,
+so memory stays the same however long the lap is.
+Watch worn on the left wrist, hand on the wheel: X is lateral, Y is longitudinal.
+*/
+struct TM8_axisStats
+{
+  int16_t min; // milli-g
+  int16_t max;
+  uint64_t sumSq;
+};
+
+class TM8_gmeter
+{
+public:
+  void reset(void);
+  void feed(const TM8_accelSample *batch, uint8_t n);
+
+  uint16_t peak(const TM8_axisStats &a); // largest |g| either way, milli-g
+  uint16_t rms(const TM8_axisStats &a);
+
+  TM8_axisStats lat;
+  TM8_axisStats lon;
+  uint32_t samples;
+};
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_GMETER_H_
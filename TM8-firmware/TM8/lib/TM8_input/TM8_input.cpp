@@ -0,0 +1,191 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_input.h"
+
+#include <Arduino.h>
+#include <ArduinoLowPower.h>
+#include <TM8_sleep.h>
+
+//----------------------------------------------------------------------------
+
+TM8_input Input;
+
+static const TM8_inputTiming defaultTiming = {20, 600, 150, 250};
+
+// attachInterrupt() only takes plain functions
+static void edge0(void) { Input.edge(0); }
+static void edge1(void) { Input.edge(1); }
+static void edge2(void) { Input.edge(2); }
+static void edge3(void) { Input.edge(3); }
+static void (*const edgeIsr[INPUT_NUM_BUTTONS])(void) = {edge0, edge1, edge2, edge3};
+
+/*
+pins are btn1..btn4, already set up as pulled up inputs (PA12 needs the
+PORT register dance in setup(), pinMode() freezes it)
+*/
+void TM8_input::begin(const uint8_t *pins) {
+  setTiming();
+  head = tail = 0;
+
+  for (uint8_t b=0; b<INPUT_NUM_BUTTONS; b++) {
+    port[b] = g_APinDescription[pins[b]].ulPort;
+    mask[b] = 1UL << g_APinDescription[pins[b]].ulPin;
+    pressHook[b] = 0;
+    edgePending[b] = false;
+    down[b] = !readLevel(b);
+    longSent[b] = true; // a button held through boot shouldn't fire LONG
+    releaseTime[b] = -0x80000000L;
+
+    // both edges, and able to wake the MCU from STANDBY
+    LowPower.attachInterruptWakeup(pins[b], edgeIsr[b], CHANGE);
+
+    // EIC majority filter, eats sub-100us glitches before they ever reach edge()
+    uint8_t n = g_APinDescription[pins[b]].ulExtInt;
+    EIC->CONFIG[n >> 3].reg |= EIC_CONFIG_FILTEN0 << ((n & 7) * 4);
+  }
+}
+
+void TM8_input::onPress(uint8_t button, void (*callback)(void)) {
+  pressHook[button] = callback;
+}
+
+void TM8_input::setTiming(const TM8_inputTiming &t) {
+  timing = t;
+}
+
+void TM8_input::setTiming(void) {
+  timing = defaultTiming;
+}
+
+void TM8_input::edge(uint8_t button) {
+  edgeTime[button] = millis();
+  edgePending[button] = true;
+  Sleep.poke();
+}
+
+bool TM8_input::readLevel(uint8_t button) {
+  return PORT->Group[port[button]].IN.reg & mask[button]; // 1 open, 0 pressed
+}
+
+/*
+an edge only counts once the line has been quiet for debounceMs,
+then the level is read once and compared against the last stable state.
+the press hook runs here, once per accepted press, with interrupts off
+because Events.push() expects to be the ISR side of the ring
+*/
+void TM8_input::poll(void) {
+  uint32_t now = millis();
+
+  for (uint8_t b=0; b<INPUT_NUM_BUTTONS; b++) {
+    if (edgePending[b] && now - edgeTime[b] >= timing.debounceMs) {
+      edgePending[b] = false;
+      bool isDown = !readLevel(b);
+      if (isDown != down[b]) {
+        down[b] = isDown;
+        uint32_t t = edgeTime[b];
+        if (isDown) {
+          push(b, INPUT_PRESS, t);
+          if (pressHook[b]) {
+            noInterrupts();
+            pressHook[b]();
+            interrupts();
+          }
+          if (t - releaseTime[b] <= timing.doubleMs) push(b, INPUT_DOUBLE, t);
+          pressTime[b] = t;
+          longSent[b] = false;
+        } else {
+          push(b, INPUT_RELEASE, t);
+          releaseTime[b] = t;
+        }
+      }
+    }
+
+    if (!down[b]) continue;
+    if (!longSent[b] && now - pressTime[b] >= timing.longMs) {
+      longSent[b] = true;
+      repeatTime[b] = now;
+      push(b, INPUT_LONG, now);
+    } else if (longSent[b] && now - repeatTime[b] >= timing.repeatMs) {
+      repeatTime[b] += timing.repeatMs;
+      push(b, INPUT_REPEAT, now);
+    }
+  }
+}
+
+bool TM8_input::next(TM8_inputEvent &e) {
+  poll();
+  if (head == tail) return false;
+  e = queue[tail];
+  tail = (tail + 1) % INPUT_QUEUE_LEN;
+  return true;
+}
+
+/*
+waits up to ms for an event, asleep in between instead of spinning.
+the governor wakes for the timeout or the next debounce/long press/repeat
+deadline, whichever is first, and an edge pokes it awake right away
+*/
+bool TM8_input::wait(TM8_inputEvent &e, uint32_t ms) {
+  uint32_t start = millis();
+  while (!next(e)) {
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= ms) return false;
+    Sleep.wakeIn(ms - elapsed);
+    uint32_t due = nextDeadline(); // debounce, long press, repeat
+    if (due != 0xFFFFFFFF) Sleep.wakeIn(due);
+    Sleep.until();
+  }
+  return true;
+}
+
+/*
+millis() stops in STANDBY, so a release from before a long sleep would look
+like it was a moment ago and the waking press would read as a double click
+*/
+void TM8_input::resync(void) {
+  uint32_t now = millis();
+  for (uint8_t b=0; b<INPUT_NUM_BUTTONS; b++) {
+    releaseTime[b] = now - 0x80000000UL; // as far back as the wraparound math allows
+  }
+}
+
+void TM8_input::flush(void) {
+  poll();
+  tail = head;
+}
+
+bool TM8_input::pressed(uint8_t button) {
+  return down[button];
+}
+
+uint32_t TM8_input::nextDeadline(void) {
+  uint32_t now = millis();
+  uint32_t soonest = 0xFFFFFFFF;
+
+  for (uint8_t b=0; b<INPUT_NUM_BUTTONS; b++) {
+    int32_t due;
+    if (edgePending[b]) {
+      due = edgeTime[b] + timing.debounceMs - now;
+    } else if (down[b] && !longSent[b]) {
+      due = pressTime[b] + timing.longMs - now;
+    } else if (down[b]) {
+      due = repeatTime[b] + timing.repeatMs - now;
+    } else {
+      continue;
+    }
+    if (due < 0) due = 0; // already overdue
+    if ((uint32_t)due < soonest) soonest = due;
+  }
+  return soonest;
+}
+
+void TM8_input::push(uint8_t button, uint8_t type, uint32_t time) {
+  uint8_t n = (head + 1) % INPUT_QUEUE_LEN;
+  if (n == tail) return; // full, drop the newest
+  queue[head].button = button;
+  queue[head].type = type;
+  queue[head].time = time;
+  head = n;
+}
@@ -0,0 +1,94 @@
+#ifndef _TM8_INPUT_H_
+#define _TM8_INPUT_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+#define INPUT_NUM_BUTTONS   4
+#define INPUT_QUEUE_LEN     16
+
+// button indices, same numbering as the case
+#define BTN1  0 // top left, scroll up
+#define BTN2  1 // bottom left, scroll down
+#define BTN3  2 // top right, confirm/enter
+#define BTN4  3 // bottom right, cancel/exit
+
+// event types
+#define INPUT_PRESS     1
+#define INPUT_RELEASE   2
+#define INPUT_LONG      3 // still held after longMs
+#define INPUT_REPEAT    4 // every repeatMs after INPUT_LONG until released
+#define INPUT_DOUBLE    5 // second press within doubleMs of the last release, comes right after its INPUT_PRESS
+
+//----------------------------------------------------------------------------
+
+struct TM8_inputEvent
+{
+  uint8_t button;
+  uint8_t type;
+  uint32_t time; // millis() of the edge that caused it
+};
+
+struct TM8_inputTiming
+{
+  uint16_t debounceMs;
+  uint16_t longMs;
+  uint16_t repeatMs;
+  uint16_t doubleMs;
+};
+
+/*
+Central button handling.
+Every button edge is timestamped by an EIC interrupt (with the EIC's own glitch
+filter on), then a software debounce window decides the real state, so nothing
+has to spin on readBtn or delay() to get clean presses.
+Edges are turned into events by poll(), apps pull them with next().
+*/
+class TM8_input
+{
+public:
+  void begin(const uint8_t *pins);
+  void onPress(uint8_t button, void (*callback)(void)); // debounced, called from poll() with interrupts off
+  void setTiming(const TM8_inputTiming &t);
+  void setTiming(void); // back to defaults
+
+  void poll(void);
+  bool next(TM8_inputEvent &e); // polls, then pops the oldest event
+  bool wait(TM8_inputEvent &e, uint32_t ms); // next() with a timeout, sleeps in between
+  void resync(void); // after a STANDBY sleep
+  void flush(void); // drops queued events, e.g. after a blocking animation
+  bool pressed(uint8_t button);
+  uint32_t nextDeadline(void); // ms until poll() has something time based to do, 0xFFFFFFFF if nothing
+
+  void edge(uint8_t button); // ISR entry
+
+  TM8_inputTiming timing;
+
+private:
+  void push(uint8_t button, uint8_t type, uint32_t time);
+  bool readLevel(uint8_t button);
+
+  uint8_t port[INPUT_NUM_BUTTONS];
+  uint32_t mask[INPUT_NUM_BUTTONS];
+  void (*pressHook[INPUT_NUM_BUTTONS])(void);
+
+  volatile uint32_t edgeTime[INPUT_NUM_BUTTONS];
+  volatile bool edgePending[INPUT_NUM_BUTTONS];
+
+  bool down[INPUT_NUM_BUTTONS]; // debounced state
+  bool longSent[INPUT_NUM_BUTTONS];
+  uint32_t pressTime[INPUT_NUM_BUTTONS];
+  uint32_t releaseTime[INPUT_NUM_BUTTONS];
+  uint32_t repeatTime[INPUT_NUM_BUTTONS];
+
+  TM8_inputEvent queue[INPUT_QUEUE_LEN];
+  uint8_t head;
+  uint8_t tail;
+};
+
+extern TM8_input Input;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_INPUT_H_
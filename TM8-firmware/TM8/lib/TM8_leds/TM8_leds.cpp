@@ -0,0 +1,216 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_leds.h"
+
+#include <Arduino.h>
+#include "wiring_private.h" // pinPeripheral()
+#include <TM8_clock.h>
+
+//----------------------------------------------------------------------------
+
+#define LED_SOFT    0xFF // no TCC0 output on this pin
+#define LED_TOP     1024 // TCC0 PER + 1
+
+TM8_leds Leds;
+
+// TM8 pins with a TCC0 output. WO[4..7] repeat CC[0..3]
+static const struct
+{
+  uint8_t port;
+  uint8_t pin;
+  uint8_t cc;
+  uint8_t mux;
+} tccPins[] =
+{
+  {0, 4, 0, PIO_TIMER}, // PA04, A3, WO[0]
+  {0, 15, 1, PIO_TIMER_ALT}, // PA15, D5, WO[5]
+  {0, 20, 2, PIO_TIMER_ALT}, // PA20, D6, WO[6]
+  {0, 21, 3, PIO_TIMER_ALT}, // PA21, D7, WO[7]
+};
+
+static void tccSync(void) {
+  while (TCC0->SYNCBUSY.reg);
+}
+
+// square law, rounded up so level 1 is still the smallest step above off
+static uint16_t duty(uint8_t level) {
+  return ((uint16_t)level * level + 63) >> 6;
+}
+
+// what the pin shows for the channel's level, see the soft channel limits in TM8_leds.h
+static uint8_t shown(const TM8_ledChannel &c) {
+  uint8_t l = c.level >> 8;
+  if (c.cc != LED_SOFT || !l) return l;
+  if (l < LED_SOFT_MIN / 2) return 0;
+  if (l < LED_SOFT_MIN) return LED_SOFT_MIN;
+  if (l > LED_SOFT_MAX) return LED_FULL;
+  return l;
+}
+
+void TM8_leds::begin(const uint8_t *pins, uint8_t n) {
+  count = n > LED_MAX_CHANNELS ? LED_MAX_CHANNELS : n;
+  pwmOn = false;
+
+  PM->APBCMASK.reg |= PM_APBCMASK_TCC0;
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK3 | GCLK_CLKCTRL_ID_TCC0_TCC1; // shared with the buzzer's TCC1
+  while (GCLK->STATUS.bit.SYNCBUSY);
+
+  TCC0->CTRLA.reg = TCC_CTRLA_SWRST;
+  while (TCC0->CTRLA.bit.SWRST);
+  TCC0->CTRLA.reg = TCC_CTRLA_PRESCALER_DIV16 | TCC_CTRLA_RUNSTDBY;
+  TCC0->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
+  TCC0->PER.reg = LED_TOP - 1;
+  tccSync();
+  NVIC_SetPriority(TCC0_IRQn, 3);
+  NVIC_EnableIRQ(TCC0_IRQn);
+
+  for (uint8_t i=0; i<count; i++) {
+    TM8_ledChannel &c = chan[i];
+    c.port = g_APinDescription[pins[i]].ulPort;
+    c.pinNum = g_APinDescription[pins[i]].ulPin;
+    c.mask = 1UL << c.pinNum;
+    c.cc = LED_SOFT;
+    c.level = 0;
+    c.step = 0;
+    c.target = 0;
+    c.acc = 0;
+
+    pinMode(pins[i], OUTPUT);
+    digitalWrite(pins[i], LOW);
+    for (uint8_t t=0; t<sizeof(tccPins) / sizeof(tccPins[0]); t++) {
+      if (tccPins[t].port != c.port || tccPins[t].pin != c.pinNum) continue;
+      c.cc = tccPins[t].cc;
+      pinPeripheral(pins[i], (EPioType)tccPins[t].mux); // mux stays on GPIO until the channel dims
+      PORT->Group[c.port].PINCFG[c.pinNum].reg &= ~PORT_PINCFG_PMUXEN;
+    }
+  }
+}
+
+void TM8_leds::set(uint8_t ch, uint8_t level) {
+  if (ch >= count) return;
+  noInterrupts();
+  TM8_ledChannel &c = chan[ch];
+  c.level = level << 8;
+  c.target = level;
+  c.step = 0;
+  apply(c);
+  refresh();
+  interrupts();
+}
+
+void TM8_leds::fadeTo(uint8_t ch, uint8_t level, uint16_t ms) {
+  uint32_t periods = (uint32_t)ms * LED_PWM_HZ / 1000;
+  if (ch >= count) return;
+  if (!periods) {
+    set(ch, level);
+    return;
+  }
+  noInterrupts();
+  TM8_ledChannel &c = chan[ch];
+  uint16_t goal = level << 8;
+  uint16_t diff = goal > c.level ? goal - c.level : c.level - goal;
+  c.target = level;
+  c.step = diff / periods;
+  if (diff && !c.step) c.step = 1;
+  refresh();
+  interrupts();
+}
+
+bool TM8_leds::fading(void) {
+  for (uint8_t i=0; i<count; i++) {
+    if (chan[i].step) return true;
+  }
+  return false;
+}
+
+void TM8_leds::off(void) {
+  for (uint8_t i=0; i<count; i++) set(i, 0);
+}
+
+void TM8_leds::bar(uint16_t value, uint16_t full, uint8_t level) {
+  uint32_t lit = full ? (uint32_t)value * LED_BAR_LEN * 256 / full : 0;
+  for (uint8_t i=0; i<LED_BAR_LEN; i++) {
+    int32_t part = (int32_t)lit - i * 256;
+    if (part < 0) part = 0;
+    if (part > 256) part = 256;
+    set(LED_CH_BAR + i, part * level / 256);
+  }
+}
+
+/*
+fades move every channel one step per PWM period, soft channels get their
+sigma-delta bit for the period: on whenever the accumulated duty spills over
+*/
+void TM8_leds::tick(void) {
+  bool done = false;
+  for (uint8_t i=0; i<count; i++) {
+    TM8_ledChannel &c = chan[i];
+    if (c.step) {
+      uint16_t goal = c.target << 8;
+      if (c.level < goal) c.level = goal - c.level <= c.step ? goal : c.level + c.step;
+      else c.level = c.level - goal <= c.step ? goal : c.level - c.step;
+      if (c.level == goal) {
+        c.step = 0;
+        done = true;
+      }
+      apply(c);
+    }
+
+    uint8_t l = shown(c);
+    if (c.cc != LED_SOFT || !l || l == LED_FULL) continue;
+    c.acc += duty(l);
+    if (c.acc >= LED_TOP) {
+      c.acc -= LED_TOP;
+      PORT->Group[c.port].OUTSET.reg = c.mask;
+    } else {
+      PORT->Group[c.port].OUTCLR.reg = c.mask;
+    }
+  }
+  if (done) refresh();
+}
+
+// off and full are GPIO, only the levels in between need TCC0 or tick()
+void TM8_leds::apply(TM8_ledChannel &c) {
+  uint8_t l = shown(c);
+  if (!l || l == LED_FULL) {
+    PORT->Group[c.port].PINCFG[c.pinNum].reg &= ~PORT_PINCFG_PMUXEN;
+    if (l) PORT->Group[c.port].OUTSET.reg = c.mask;
+    else PORT->Group[c.port].OUTCLR.reg = c.mask;
+  } else if (c.cc != LED_SOFT) {
+    TCC0->CCB[c.cc].reg = duty(l); // buffered, takes effect at the next period
+    PORT->Group[c.port].PINCFG[c.pinNum].reg |= PORT_PINCFG_PMUXEN;
+  }
+}
+
+// starts/stops TCC0 and its interrupt to match what the channels need right now
+void TM8_leds::refresh(void) {
+  bool pwm = false;
+  bool irq = false;
+  for (uint8_t i=0; i<count; i++) {
+    uint8_t l = shown(chan[i]);
+    bool dimmed = l && l != LED_FULL;
+    if (chan[i].step) pwm = irq = true;
+    if (dimmed) pwm = true;
+    if (dimmed && chan[i].cc == LED_SOFT) irq = true;
+  }
+
+  if (pwm != pwmOn) {
+    pwmOn = pwm;
+    Clock.holdOsc8m(pwm);
+    TCC0->CTRLA.bit.ENABLE = pwm;
+    tccSync();
+  }
+  if (irq) {
+    TCC0->INTFLAG.reg = TCC_INTFLAG_OVF;
+    TCC0->INTENSET.reg = TCC_INTENSET_OVF;
+  } else {
+    TCC0->INTENCLR.reg = TCC_INTENCLR_OVF;
+  }
+}
+
+void TCC0_Handler(void) {
+  TCC0->INTFLAG.reg = TCC_INTFLAG_OVF;
+  Leds.tick();
+}
@@ -0,0 +1,83 @@
+#ifndef _TM8_LEDS_H_
+#define _TM8_LEDS_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+#define LED_MAX_CHANNELS  8
+#define LED_FULL          255 // levels are perceived brightness, 0-255
+#define LED_DIM           96  // about a sixth of the current of LED_FULL
+#define LED_PWM_HZ        488 // 8MHz / 16 / 1024
+
+// what a soft channel can show without strobing, see TM8_leds
+#define LED_SOFT_MIN      116 // duty 211/1024, pulses at 100Hz
+#define LED_SOFT_MAX      228 // duty 813/1024, gaps at 100Hz
+
+// TM8's channels, in the order main.cpp hands the pins to begin()
+#define LED_CH_BAR        0 // 0-4, the five status LEDs
+#define LED_BAR_LEN       5
+#define LED_CH_FLASH      5 // flashlight
+#define LED_CH_BL         6 // left backlight
+
+//----------------------------------------------------------------------------
+
+struct TM8_ledChannel
+{
+  uint8_t port;
+  uint32_t mask; // PORT bit
+  uint8_t pinNum;
+  uint8_t cc; // TCC0 compare channel, LED_SOFT if the pin has none
+  uint16_t level; // 8.8 fixed point, the whole part is what set()/fadeTo() talk in
+  uint16_t step; // per PWM period while fading, 0 when not
+  uint8_t target;
+  uint16_t acc; // sigma-delta accumulator for LED_SOFT channels
+};
+
+/*
+PWM for the status LEDs, flashlight and backlight.
+TCC0 runs off GCLK3 (8MHz OSC8M) at LED_PWM_HZ with 10 bit resolution, and four
+of TM8's pins have a TCC0 output: A3, D5, D6 (flashlight) and D7. The rest (A1
+and D8, whose timers belong to the buzzer, and the backlight on PA27) are
+dithered by the TCC0 overflow interrupt instead, which only runs while one of
+them is dimmed or a fade is in progress.
+Dithering at LED_PWM_HZ gives a soft channel one pulse per period at best, so at
+low duty the pulses come slower than the eye fuses them and the LED strobes (and
+likewise the gaps near full). Soft channels therefore only show LED_SOFT_MIN to
+LED_SOFT_MAX: a level below LED_SOFT_MIN is raised to it, or is off when it's
+under half of it, and one above LED_SOFT_MAX is full on. The level is still
+stored as given and fades still run through it, only the output is clamped.
+Levels go through a square law (gamma 2) on the way to the duty cycle, so a
+linear fade looks linear. Off and LED_FULL are plain GPIO, they cost no clock or
+interrupt and survive STANDBY; anything in between holds OSC8M for STANDBY.
+*/
+class TM8_leds
+{
+public:
+  void begin(const uint8_t *pins, uint8_t n);
+
+  void set(uint8_t ch, uint8_t level);
+  void fadeTo(uint8_t ch, uint8_t level, uint16_t ms); // returns right away, the interrupt does the rest
+  uint8_t level(uint8_t ch) { return chan[ch].level >> 8; }
+  bool fading(void);
+  void off(void);
+
+  // meter on the bar LEDs: value out of full, the last LED dimmed for the remainder
+  void bar(uint16_t value, uint16_t full, uint8_t level = LED_FULL);
+
+  void tick(void); // TCC0 overflow
+
+private:
+  void apply(TM8_ledChannel &c);
+  void refresh(void);
+
+  TM8_ledChannel chan[LED_MAX_CHANNELS];
+  uint8_t count;
+  bool pwmOn; // TCC0 running, and OSC8M held for STANDBY
+};
+
+extern TM8_leds Leds;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_LEDS_H_
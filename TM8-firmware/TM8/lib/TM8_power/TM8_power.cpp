@@ -0,0 +1,97 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "Wire.h"
+
+#include "TM8_power.h"
+
+#include <Arduino.h>
+
+//----------------------------------------------------------------------------
+
+TM8_power Power;
+
+// bus each device hangs off, 0xFF for none
+static const uint8_t parentBus[PWR_NUM_RESOURCES] = {0xFF, 0xFF, PWR_SERCOM2, PWR_SERCOM2, PWR_SERCOM3, 0xFF};
+
+static const uint32_t apbMask[2] = {PM_APBCMASK_SERCOM2, PM_APBCMASK_SERCOM3};
+static const uint16_t gclkId[2] = {GCLK_CLKCTRL_ID_SERCOM2_CORE, GCLK_CLKCTRL_ID_SERCOM3_CORE};
+
+void TM8_power::begin(TwoWire *sercom2Bus, TwoWire *sercom3Bus) {
+  bus[PWR_SERCOM2] = sercom2Bus;
+  bus[PWR_SERCOM3] = sercom3Bus;
+  for (uint8_t i=0; i<PWR_NUM_RESOURCES; i++) {
+    onFn[i] = 0;
+    offFn[i] = 0;
+    count[i] = 0;
+  }
+  count[PWR_SERCOM2] = 1;
+  count[PWR_SERCOM3] = 1;
+}
+
+void TM8_power::attach(uint8_t res, TM8_powerFn on, TM8_powerFn off) {
+  onFn[res] = on;
+  offFn[res] = off;
+}
+
+void TM8_power::settle(void) {
+  for (uint8_t i=PWR_SERCOM3+1; i<PWR_NUM_RESOURCES; i++) {
+    if (count[i]) continue;
+    count[i] = 1; // one pass through the normal path so the parent bus gets held
+    release(i);
+  }
+}
+
+void TM8_power::acquire(uint8_t res) {
+  if (count[res]++) return;
+
+  if (res <= PWR_SERCOM3) {
+    busOn(res);
+    return;
+  }
+  uint8_t parent = parentBus[res];
+  if (parent != 0xFF) acquire(parent);
+  if (onFn[res]) onFn[res]();
+  if (parent != 0xFF) release(parent);
+}
+
+void TM8_power::release(uint8_t res) {
+  if (!count[res] || --count[res]) return;
+
+  if (res <= PWR_SERCOM3) {
+    busOff(res);
+    return;
+  }
+  uint8_t parent = parentBus[res];
+  if (parent != 0xFF) acquire(parent);
+  if (offFn[res]) offFn[res]();
+  if (parent != 0xFF) release(parent);
+}
+
+bool TM8_power::isOn(uint8_t res) {
+  return count[res] != 0;
+}
+
+uint8_t TM8_power::holders(uint8_t res) {
+  return count[res];
+}
+
+void TM8_power::retime(void) {
+  for (uint8_t i=PWR_SERCOM2; i<=PWR_SERCOM3; i++) {
+    if (count[i]) bus[i]->setClock(bus[i]->getClock());
+  }
+}
+
+// the bus is re-initialised from scratch at whatever clock it last ran
+void TM8_power::busOn(uint8_t res) {
+  PM->APBCMASK.reg |= apbMask[res];
+  bus[res]->begin(); // sets up and enables the SERCOM core clock again
+}
+
+void TM8_power::busOff(uint8_t res) {
+  bus[res]->end();
+  GCLK->CLKCTRL.reg = gclkId[res]; // CLKEN cleared
+  while (GCLK->STATUS.bit.SYNCBUSY);
+  PM->APBCMASK.reg &= ~apbMask[res];
+}
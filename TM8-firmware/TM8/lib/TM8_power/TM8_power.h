@@ -0,0 +1,58 @@
+#ifndef _TM8_POWER_H_
+#define _TM8_POWER_H_
+
+#include <inttypes.h>
+
+class TwoWire;
+
+//----------------------------------------------------------------------------
+// Resources. Each one is in its lowest power state unless someone holds it.
+
+#define PWR_SERCOM2   0 // wire1: right LCD, LIS3DH, BME680, EEPROM. APB + core clock
+#define PWR_SERCOM3   1 // Wire: left LCD, MAX17048. APB + core clock
+#define PWR_BME       2 // BME680 out of sleep mode
+#define PWR_ACCEL     3 // LIS3DH sampling, power down otherwise
+#define PWR_FUEL      4 // MAX17048 awake, forced hibernate otherwise
+#define PWR_USB       5 // USB attached to the host
+#define PWR_NUM_RESOURCES 6
+
+//----------------------------------------------------------------------------
+
+typedef void (*TM8_powerFn)(void);
+
+/*
+Reference counted power switches.
+acquire() turns a resource on when its count goes 0 -> 1, release() turns it
+back off when the count drops to 0, so nested users (the watch face and an app,
+two apps sharing the accelerometer) don't have to know about each other.
+Devices sit on a bus, their on/off hooks run with that bus held.
+The hooks for the external chips live with the code that owns their config.
+*/
+class TM8_power
+{
+public:
+  void begin(TwoWire *sercom2Bus, TwoWire *sercom3Bus); // buses already running, held once by the caller
+  void attach(uint8_t res, TM8_powerFn on, TM8_powerFn off);
+  void settle(void); // applies the off state to everything nobody holds, once all hooks are attached
+
+  void acquire(uint8_t res);
+  void release(uint8_t res);
+  bool isOn(uint8_t res);
+  uint8_t holders(uint8_t res);
+  void retime(void); // recompute the baud of every running bus after a core clock change
+
+private:
+  void busOn(uint8_t res);
+  void busOff(uint8_t res);
+
+  TwoWire *bus[2];
+  TM8_powerFn onFn[PWR_NUM_RESOURCES];
+  TM8_powerFn offFn[PWR_NUM_RESOURCES];
+  uint8_t count[PWR_NUM_RESOURCES];
+};
+
+extern TM8_power Power;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_POWER_H_
@@ -0,0 +1,177 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_sleep.h"
+
+#include <Arduino.h>
+#include <TM8_power.h>
+
+//----------------------------------------------------------------------------
+
+#define MAX_CHUNK_MS  60000 // 16 bit counter at 1024Hz tops out at 64s
+
+TM8_sleep Sleep;
+
+static void tcSync(void) {
+  while (TC3->COUNT16.STATUS.bit.SYNCBUSY);
+}
+
+void TM8_sleep::begin(void) {
+  PM->APBCMASK.reg |= PM_APBCMASK_TC3;
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK2 | GCLK_CLKCTRL_ID_TCC2_TC3;
+  while (GCLK->STATUS.bit.SYNCBUSY);
+
+  TC3->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+  while (TC3->COUNT16.CTRLA.bit.SWRST);
+  TC3->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV1 | TC_CTRLA_RUNSTDBY;
+  tcSync();
+  TC3->COUNT16.CTRLBSET.reg = TC_CTRLBSET_ONESHOT;
+  tcSync();
+  TC3->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+
+  NVIC_SetPriority(TC3_IRQn, 3);
+  NVIC_EnableIRQ(TC3_IRQn);
+  expired = false;
+}
+
+/*
+SysTick is stopped in standby, so the first interrupt of any kind (timer, buttons,
+ALRT, INT2) ends the sleep early, same as LowPower.deepSleep().
+millis() doesn't move in standby, hence the return value.
+*/
+uint32_t TM8_sleep::standbyFor(uint32_t ms) {
+  uint32_t slept = 0;
+
+  SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+  while (ms) {
+    uint32_t chunk = ms > MAX_CHUNK_MS ? MAX_CHUNK_MS : ms;
+    uint16_t ticks = chunk * SLEEP_TICK_HZ / 1000;
+    if (!ticks) ticks = 1;
+
+    startTimer(ticks);
+    sleepUnlessPoked();
+    uint16_t count = stopTimer();
+
+    if (!expired) { // woken by something else
+      return slept + (uint32_t)count * 1000 / SLEEP_TICK_HZ;
+    }
+    slept += chunk;
+    ms -= chunk;
+  }
+  return slept;
+}
+
+void TM8_sleep::idle(void) {
+  wfi(SLEEP_IDLE0);
+}
+
+uint32_t TM8_sleep::nap(uint32_t ms, bool standbyOk) {
+  uint32_t start = millis();
+  wakeIn(ms);
+  if (until(standbyOk) == SLEEP_STANDBY) return standbySlept;
+  return millis() - start;
+}
+
+/*
+Sleep governor.
+Whoever has something coming up (next LCD frame, FIFO batch, sensor conversion,
+debounce) calls wakeAt()/wakeIn(), then until() sleeps as deep as that gap and
+the running peripherals allow:
+ - USB held: IDLE0, the USB module needs the AHB and APB clocks
+ - standby allowed by the caller and the gap is at least SLEEP_STANDBY_MIN_MS: STANDBY.
+   only for callers that don't measure time with millis(), it stops in STANDBY
+ - otherwise IDLE2, or IDLE1 when the deadline is less than SLEEP_IDLE2_MIN_MS out
+In the IDLE modes SysTick still wakes the core every ms, until() goes straight
+back down unless the deadline passed or an ISR poke()d. With no deadline at all
+it sleeps until the next poke(). nap() is the same for a plain "sleep about this
+long", FIFO batches and the like, so those get the USB check too.
+*/
+void TM8_sleep::wakeAt(uint32_t t) {
+  if (!deadlineSet || (int32_t)(t - deadline) < 0) deadline = t;
+  deadlineSet = true;
+}
+
+void TM8_sleep::wakeIn(uint32_t ms) {
+  if (ms > 0x7FFFFFFF) ms = 0x7FFFFFFF; // "forever" timeouts, keeps the signed compare sane
+  wakeAt(millis() + ms);
+}
+
+uint8_t TM8_sleep::until(bool standbyOk) {
+  bool timed = deadlineSet;
+  int32_t left = timed ? (int32_t)(deadline - millis()) : 0x7FFFFFFF;
+  deadlineSet = false;
+
+  uint8_t depth = depthFor(left, standbyOk);
+  if (depth == SLEEP_STANDBY) {
+    standbySlept = standbyFor(timed ? left : 0xFFFFFFFF); // any interrupt ends it
+  } else if (depth != SLEEP_NONE) {
+    while (!poked && (!timed || (int32_t)(deadline - millis()) > 0)) {
+      wfi(depth);
+    }
+  }
+  poked = false;
+  return depth;
+}
+
+void TM8_sleep::delay(uint32_t ms) {
+  uint32_t due = millis() + ms;
+  while ((int32_t)(due - millis()) > 0) {
+    wakeAt(due);
+    until();
+  }
+}
+
+uint8_t TM8_sleep::depthFor(int32_t left, bool standbyOk) {
+  if (left <= 0) return SLEEP_NONE;
+  if (Power.isOn(PWR_USB)) return SLEEP_IDLE0;
+  if (standbyOk && left >= SLEEP_STANDBY_MIN_MS) return SLEEP_STANDBY;
+  if (left < SLEEP_IDLE2_MIN_MS) return SLEEP_IDLE1;
+  return SLEEP_IDLE2;
+}
+
+void TM8_sleep::wfi(uint8_t depth) {
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+  PM->SLEEP.reg = PM_SLEEP_IDLE(depth - SLEEP_IDLE0);
+  sleepUnlessPoked();
+}
+
+/*
+poked is tested with interrupts masked, or a poke landing between the test and
+the WFI would sleep through to the next deadline, up to a minute in STANDBY.
+WFI still wakes on an interrupt that is pending while PRIMASK is set, and its
+handler runs as soon as they're unmasked again
+*/
+void TM8_sleep::sleepUnlessPoked(void) {
+  __disable_irq();
+  if (!poked) {
+    __DSB();
+    __WFI();
+  }
+  __enable_irq();
+}
+
+void TM8_sleep::startTimer(uint16_t ticks) {
+  expired = false;
+  TC3->COUNT16.COUNT.reg = 0;
+  tcSync();
+  TC3->COUNT16.CC[0].reg = ticks;
+  tcSync();
+  TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  TC3->COUNT16.CTRLA.bit.ENABLE = 1;
+  tcSync();
+}
+
+uint16_t TM8_sleep::stopTimer(void) {
+  TC3->COUNT16.READREQ.reg = TC_READREQ_RREQ | TC_READREQ_ADDR(0x10); // COUNT
+  tcSync();
+  uint16_t count = TC3->COUNT16.COUNT.reg;
+  TC3->COUNT16.CTRLA.bit.ENABLE = 0;
+  tcSync();
+  return count;
+}
+
+void TC3_Handler(void) {
+  TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  Sleep.expired = true;
+}
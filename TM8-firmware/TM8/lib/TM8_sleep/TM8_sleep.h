@@ -0,0 +1,63 @@
+#ifndef _TM8_SLEEP_H_
+#define _TM8_SLEEP_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+#define SLEEP_TICK_HZ   1024 // TC3 runs off RTCZero's 1024Hz XOSC32K generator
+
+// sleep depths picked by until()
+#define SLEEP_NONE      0 // deadline already due
+#define SLEEP_IDLE0     1 // CPU clock off. USB keeps running
+#define SLEEP_IDLE1     2 // CPU + AHB off
+#define SLEEP_IDLE2     3 // CPU + AHB + APB off, GCLKs (EIC, TCs, SysTick) still run
+#define SLEEP_STANDBY   4 // everything but the 32k domain off, millis() stops
+
+#define SLEEP_IDLE2_MIN_MS    2  // closer deadlines use IDLE1, the APB bridges stay up for the next I2C frame
+#define SLEEP_STANDBY_MIN_MS  50 // below this the wake up (DFLL relock, Input.resync) costs more than it saves
+
+//----------------------------------------------------------------------------
+
+/*
+Millisecond sleeps.
+ArduinoLowPower's timed sleeps go through an RTC alarm with 1 second resolution,
+which is useless for anything that has to come back in a few hundred ms (FIFO
+batches, sampling). TC3 on GCLK2 keeps counting in STANDBY, so it can wake the
+MCU with ~1ms resolution from either sleep mode.
+*/
+class TM8_sleep
+{
+public:
+  void begin(void); // after rtc.begin(), which sets up GCLK2
+  void idle(void); // one WFI in IDLE0, the next SysTick or interrupt ends it
+  uint32_t nap(uint32_t ms, bool standbyOk = false); // wakeIn() + until(), returns ms actually slept, millis() can't tell in STANDBY
+
+  void wakeAt(uint32_t t); // millis() deadline for the next until(), the earliest one wins
+  void wakeIn(uint32_t ms);
+  uint8_t until(bool standbyOk = false); // sleeps to the deadline or the next poke(), returns the depth used
+  void poke(void) { poked = true; } // from ISRs, ends until() early
+  void delay(uint32_t ms); // delay() through the governor, pokes don't cut it short
+
+  volatile bool expired;
+
+private:
+  uint8_t depthFor(int32_t left, bool standbyOk);
+  void wfi(uint8_t depth);
+  uint32_t standbyFor(uint32_t ms); // returns ms actually slept
+  void sleepUnlessPoked(void);
+
+  uint32_t deadline;
+  bool deadlineSet;
+  volatile bool poked;
+  uint32_t standbySlept; // by the last until() that went to STANDBY
+
+  void startTimer(uint16_t ticks);
+  uint16_t stopTimer(void);
+};
+
+extern TM8_sleep Sleep;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_SLEEP_H_
@@ -0,0 +1,91 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_steps.h"
+
+//----------------------------------------------------------------------------
+
+#define GRAVITY_SHIFT   6 // DC tracker time constant, 64 samples
+#define ENVELOPE_SHIFT  6 // envelope decay, 64 samples
+
+// bit by bit integer square root, 16 iterations, no divides (M0+ has no divider)
+uint16_t isqrt32(uint32_t v) {
+  uint32_t res = 0;
+  uint32_t bit = 1UL << 30;
+
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= res + bit) {
+      v -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return res;
+}
+
+void TM8_steps::begin(uint16_t sampleHz) {
+  minInterval = (uint32_t)STEP_MIN_INTERVAL * sampleHz / 1000;
+  maxInterval = (uint32_t)STEP_MAX_INTERVAL * sampleHz / 1000;
+  gravity = 1000L << 4; // start at 1g so the first seconds don't look like a swing
+  filt = 0;
+  envelope = 0;
+  above = false;
+  sinceStep = maxInterval;
+  pending = 0;
+  resetDay();
+}
+
+void TM8_steps::feed(int16_t x, int16_t y, int16_t z) {
+  uint16_t mag = isqrt32((int32_t)x * x + (int32_t)y * y + (int32_t)z * z);
+
+  // orientation independent: high pass the magnitude instead of picking an axis
+  gravity += (((int32_t)mag << 4) - gravity) >> GRAVITY_SHIFT;
+  int16_t ac = mag - (gravity >> 4);
+  filt = (filt + ac) >> 1; // 2 tap smoothing, kills single sample spikes
+
+  int16_t mag16 = filt < 0 ? -filt : filt;
+  if (mag16 > envelope) envelope = mag16;
+  else envelope -= envelope >> ENVELOPE_SHIFT;
+
+  int16_t thresh = envelope >> 1;
+  if (thresh < STEP_MIN_THRESH / 2) thresh = STEP_MIN_THRESH / 2;
+
+  if (sinceStep < 0xFFFF) sinceStep++;
+  if (sinceStep > maxInterval) pending = 0; // walk ended, start regulating again
+
+  // one full swing (up through +thresh, then down through -thresh) is one step
+  if (!above && filt > thresh) {
+    above = true;
+  } else if (above && filt < -thresh) {
+    above = false;
+    if (sinceStep >= minInterval) countStep();
+  }
+}
+
+void TM8_steps::countStep(void) {
+  sinceStep = 0;
+  if (pending < STEP_REGULATION) {
+    pending++;
+    if (pending < STEP_REGULATION) return;
+    steps += pending; // walk confirmed, book the steps held back so far
+    minuteSteps += pending;
+  } else {
+    steps++;
+    minuteSteps++;
+  }
+}
+
+void TM8_steps::minuteTick(void) {
+  if (minuteSteps >= STEP_ACTIVE_PER_MIN) activeMinutes++;
+  minuteSteps = 0;
+}
+
+void TM8_steps::resetDay(void) {
+  steps = 0;
+  activeMinutes = 0;
+  minuteSteps = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef _TM8_STEPS_H_
+#define _TM8_STEPS_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+// Step detector tuning. Amplitudes in mg, times in ms.
+
+#define STEP_MIN_THRESH     60   // smallest swing that can count as a step
+#define STEP_MIN_INTERVAL   250  // faster than 4 steps/s is shaking, not walking
+#define STEP_MAX_INTERVAL   2000 // slower than this ends the walk
+#define STEP_REGULATION     4    // steps in a row before any of them are counted
+#define STEP_ACTIVE_PER_MIN 60   // steps in a minute for it to count as an active minute
+
+//----------------------------------------------------------------------------
+
+/*
+Fixed point pedometer kernel. Integer math only, no Arduino dependencies.
+Feed it milli-g samples at a fixed rate, it removes gravity from the magnitude,
+tracks the swing envelope and counts one step per full swing that crosses an
+adaptive threshold with hysteresis. Short bursts (fewer than STEP_REGULATION
+steps) are thrown away so arm waving and bumps don't count.
+*/
+class TM8_steps
+{
+public:
+  void begin(uint16_t sampleHz);
+  void feed(int16_t x, int16_t y, int16_t z);
+  void minuteTick(void); // call once per RTC minute to book activity minutes
+  void resetDay(void);
+
+  uint32_t steps; // today's total
+  uint16_t activeMinutes; // today's minutes with at least STEP_ACTIVE_PER_MIN steps
+
+private:
+  void countStep(void);
+
+  uint16_t minInterval; // STEP_MIN/MAX_INTERVAL in samples
+  uint16_t maxInterval;
+  int32_t gravity; // magnitude DC estimate, Q4
+  int16_t filt; // smoothed AC part of the magnitude
+  int16_t envelope; // decaying peak of |filt|
+  bool above; // hysteresis state, true after crossing +threshold
+  uint16_t sinceStep; // samples since the last counted swing
+  uint8_t pending; // steps waiting on regulation
+  uint16_t minuteSteps;
+};
+
+uint16_t isqrt32(uint32_t v);
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_STEPS_H_
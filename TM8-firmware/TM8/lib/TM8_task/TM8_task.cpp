@@ -0,0 +1,96 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_task.h"
+
+#include <Arduino.h>
+#include <TM8_sleep.h>
+
+//----------------------------------------------------------------------------
+
+TM8_tasks Tasks;
+
+void taskWaitFor(TM8_task *t, uint32_t ms) {
+  t->timed = ms != TASK_FOREVER;
+  t->wake = millis() + ms;
+}
+
+bool taskExpired(TM8_task *t) {
+  return t->timed && (int32_t)(t->wake - millis()) <= 0;
+}
+
+void TM8_tasks::start(TM8_task &t, TM8_taskFn fn) {
+  t.fn = fn;
+  t.lc = 0;
+  t.timed = false;
+  t.buttons = 0;
+  t.gotEvent = false;
+}
+
+bool TM8_tasks::add(TM8_task &t, TM8_taskFn fn) {
+  for (uint8_t i=0; i<TASK_MAX_BACKGROUND; i++) {
+    if (bg[i]) continue;
+    start(t, fn);
+    bg[i] = &t;
+    return true;
+  }
+  return false;
+}
+
+void TM8_tasks::remove(TM8_task &t) {
+  for (uint8_t i=0; i<TASK_MAX_BACKGROUND; i++) {
+    if (bg[i] == &t) bg[i] = 0;
+  }
+}
+
+void TM8_tasks::run(TM8_task &t, TM8_taskFn fn) {
+  start(t, fn);
+  fg = &t;
+  Input.flush(); // the press that started the app isn't for it
+
+  bool done = false;
+  while (!done) {
+    // one event at a time, so a press and its release don't overwrite each other
+    TM8_inputEvent e;
+    while (!done && Input.next(e)) {
+      TM8_task *to = owner(e.button);
+      if (!to) continue;
+      to->event = e;
+      to->gotEvent = true;
+      done = step(to) && to == fg;
+    }
+    if (done || step(fg)) break;
+    for (uint8_t i=0; i<TASK_MAX_BACKGROUND; i++) {
+      if (bg[i]) step(bg[i]);
+    }
+    sleep();
+  }
+  fg = 0;
+}
+
+bool TM8_tasks::step(TM8_task *t) {
+  if (!t->fn) return true;
+  if (t->fn(t) == TASK_WAITING) return false;
+  if (t != fg) remove(*t);
+  t->fn = 0;
+  return true;
+}
+
+TM8_task *TM8_tasks::owner(uint8_t button) {
+  if (fg && fg->fn && fg->buttons & TASK_BTN(button)) return fg;
+  for (uint8_t i=0; i<TASK_MAX_BACKGROUND; i++) {
+    if (bg[i] && bg[i]->buttons & TASK_BTN(button)) return bg[i];
+  }
+  return 0; // nobody is listening, drop it
+}
+
+void TM8_tasks::sleep(void) {
+  if (fg->timed) Sleep.wakeAt(fg->wake);
+  for (uint8_t i=0; i<TASK_MAX_BACKGROUND; i++) {
+    if (bg[i] && bg[i]->timed) Sleep.wakeAt(bg[i]->wake);
+  }
+  uint32_t due = Input.nextDeadline();
+  if (due != 0xFFFFFFFF) Sleep.wakeIn(due);
+  Sleep.until();
+}
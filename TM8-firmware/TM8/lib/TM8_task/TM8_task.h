@@ -0,0 +1,131 @@
+#ifndef _TM8_TASK_H_
+#define _TM8_TASK_H_
+
+#include <inttypes.h>
+
+#include "TM8_input.h"
+
+//----------------------------------------------------------------------------
+
+#define TASK_MAX_BACKGROUND 4
+#define TASK_FOREVER        0xFFFFFFFF
+
+// task function results
+#define TASK_WAITING  0
+#define TASK_DONE     1
+
+#define TASK_BTN(b)     (1 << (b)) // AWAIT_BUTTON masks
+#define TASK_ALL_BTNS   0x0F
+
+//----------------------------------------------------------------------------
+
+struct TM8_task;
+typedef uint8_t (*TM8_taskFn)(TM8_task *t);
+
+struct TM8_task
+{
+  TM8_taskFn fn;
+  uint16_t lc; // where to resume, 0 = from the top
+  bool timed; // wake is valid
+  uint32_t wake; // millis() deadline of the current wait
+  uint8_t buttons; // TASK_BTN mask of an AWAIT_BUTTON in progress
+  bool gotEvent; // false if the AWAIT_BUTTON timed out
+  TM8_inputEvent event; // what ended the last AWAIT_BUTTON
+};
+
+void taskWaitFor(TM8_task *t, uint32_t ms);
+bool taskExpired(TM8_task *t);
+
+/*
+Protothread style tasks.
+A task is a plain function that the scheduler calls over and over. The macros
+below turn it into a switch on the line it last stopped at, so an AWAIT returns
+to the scheduler and the next call jumps straight back to it.
+Rules that come with it:
+ - locals don't survive an AWAIT, keep state in globals/statics
+ - no AWAIT inside a switch of your own
+ - loops and ifs around AWAITs are fine
+*/
+#define TASK_BEGIN(t)   switch ((t)->lc) { case 0:
+#define TASK_END(t)     } (t)->lc = 0; return TASK_DONE
+#define TASK_EXIT(t)    do { (t)->lc = 0; return TASK_DONE; } while (0)
+
+// lets everything else run, then carries on
+#define TASK_YIELD(t) \
+  do { \
+    taskWaitFor(t, 0); \
+    (t)->lc = __LINE__; return TASK_WAITING; case __LINE__: \
+    (t)->timed = false; \
+  } while (0)
+
+#define AWAIT_SLEEP_MS(t, ms) \
+  do { \
+    taskWaitFor(t, ms); \
+    (t)->lc = __LINE__; case __LINE__: \
+    if (!taskExpired(t)) return TASK_WAITING; \
+    (t)->timed = false; \
+  } while (0)
+
+// any event (press, release, long, ...) on a masked button, or ms without one
+#define AWAIT_BUTTON(t, mask, ms) \
+  do { \
+    (t)->buttons = (mask); \
+    (t)->gotEvent = false; \
+    taskWaitFor(t, ms); \
+    (t)->lc = __LINE__; case __LINE__: \
+    if (!(t)->gotEvent && !taskExpired(t)) return TASK_WAITING; \
+    (t)->buttons = 0; \
+    (t)->timed = false; \
+  } while (0)
+
+/*
+waits for a device to finish something it was asked to do over I2C (conversion,
+FIFO fill). Wire transfers themselves block, so done() polls the device,
+right away and then every pollMs
+*/
+#define AWAIT_BUS(t, done, pollMs) \
+  do { \
+    taskWaitFor(t, 0); \
+    (t)->lc = __LINE__; case __LINE__: \
+    if (!taskExpired(t)) return TASK_WAITING; \
+    if (!(done)()) { taskWaitFor(t, pollMs); return TASK_WAITING; } \
+    (t)->timed = false; \
+  } while (0)
+
+// re-checked whenever the scheduler wakes, whatever changes cond should poke Sleep
+#define AWAIT_UNTIL(t, cond) \
+  do { \
+    (t)->lc = __LINE__; case __LINE__: \
+    if (!(cond)) return TASK_WAITING; \
+  } while (0)
+
+//----------------------------------------------------------------------------
+
+/*
+Runs one foreground task (the app) plus any background tasks until the
+foreground one finishes. Button events go to whichever task is waiting on
+that button, the foreground first. Between passes the CPU sleeps through the
+governor until the earliest task deadline, input deadline or interrupt.
+*/
+class TM8_tasks
+{
+public:
+  bool add(TM8_task &t, TM8_taskFn fn); // background, runs alongside every foreground task
+  void remove(TM8_task &t);
+  void run(TM8_task &t, TM8_taskFn fn); // blocks until fn returns TASK_DONE
+
+private:
+  void start(TM8_task &t, TM8_taskFn fn);
+  bool step(TM8_task *t); // true once t is done
+  TM8_task *owner(uint8_t button);
+  void sleep(void);
+
+  TM8_task *fg;
+  TM8_task *bg[TASK_MAX_BACKGROUND];
+};
+
+extern TM8_tasks Tasks;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_TASK_H_
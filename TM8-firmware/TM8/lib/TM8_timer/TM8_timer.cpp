@@ -0,0 +1,184 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_timer.h"
+
+#include <Arduino.h>
+#include <RTCZero.h>
+#include <TM8_sleep.h>
+#include <TM8_events.h>
+#include <TM8_buzzer.h>
+#include <TM8_leds.h>
+
+//----------------------------------------------------------------------------
+
+TM8_timers Timers;
+
+// RTCZero only takes plain functions
+static void alarmIsr(void) {
+  Timers.fired = true;
+  Events.push(EVENT_ALARM);
+}
+
+static bool isDue(uint32_t due, uint32_t now) {
+  return (int32_t)(due - now) <= 0;
+}
+
+static bool earlier(const TM8_timerEntry &a, const TM8_timerEntry &b) {
+  return (int32_t)(a.due - b.due) < 0;
+}
+
+void TM8_timers::begin(RTCZero *clock) {
+  rtc = clock;
+  size = 0;
+  nextId = TIMER_NONE;
+  fired = false;
+  rtc->disableAlarm();
+  rtc->attachInterrupt(alarmIsr);
+}
+
+uint8_t TM8_timers::in(uint32_t secs, TM8_timerFn fn, uint8_t cue) {
+  return add(rtc->getEpoch() + secs, 0, fn, cue);
+}
+
+uint8_t TM8_timers::at(uint32_t epoch, TM8_timerFn fn, uint8_t cue) {
+  return add(epoch, 0, fn, cue);
+}
+
+uint8_t TM8_timers::every(uint32_t secs, TM8_timerFn fn, uint8_t cue) {
+  if (!secs) secs = 1;
+  return add(rtc->getEpoch() + secs, secs, fn, cue);
+}
+
+bool TM8_timers::cancel(uint8_t id) {
+  uint8_t i = find(id);
+  if (i == TIMER_MAX) return false;
+  removeAt(i);
+  arm();
+  return true;
+}
+
+bool TM8_timers::pending(uint8_t id) {
+  return find(id) != TIMER_MAX;
+}
+
+uint32_t TM8_timers::left(uint8_t id) {
+  uint8_t i = find(id);
+  if (i == TIMER_MAX) return 0;
+  int32_t secs = heap[i].due - rtc->getEpoch();
+  return secs > 0 ? secs : 0;
+}
+
+/*
+pops everything that's due, earliest first. the entry is off the heap before
+its callback runs, so callbacks are free to add or cancel timers (their own
+id included, cancelling a repeating timer from its callback stops it)
+*/
+void TM8_timers::service(void) {
+  fired = false;
+  uint32_t now = rtc->getEpoch();
+
+  while (size && isDue(heap[0].due, now)) {
+    TM8_timerEntry t = heap[0];
+    removeAt(0);
+    if (t.period) { // back on the heap under the same id, skipping whatever was slept through
+      do t.due += t.period; while (isDue(t.due, now));
+      heap[size] = t;
+      siftUp(size++);
+    }
+    cue(t.cue);
+    if (t.fn) t.fn(t.id);
+  }
+  arm();
+}
+
+uint8_t TM8_timers::add(uint32_t due, uint32_t period, TM8_timerFn fn, uint8_t cue) {
+  if (size >= TIMER_MAX) return TIMER_NONE;
+  do { // ids wrap, skip 0 and any still in use
+    nextId++;
+  } while (nextId == TIMER_NONE || find(nextId) != TIMER_MAX);
+
+  TM8_timerEntry &t = heap[size];
+  t.due = due;
+  t.period = period;
+  t.fn = fn;
+  t.cue = cue;
+  t.id = nextId;
+  siftUp(size++);
+  arm();
+  return nextId;
+}
+
+// heap index of id, TIMER_MAX if it's not pending. TIMER_MAX entries, a linear scan is fine
+uint8_t TM8_timers::find(uint8_t id) {
+  if (id == TIMER_NONE) return TIMER_MAX;
+  for (uint8_t i=0; i<size; i++) {
+    if (heap[i].id == id) return i;
+  }
+  return TIMER_MAX;
+}
+
+void TM8_timers::removeAt(uint8_t i) {
+  size--;
+  if (i == size) return;
+  heap[i] = heap[size];
+  siftDown(i);
+  siftUp(i); // the moved entry can belong either side of its new spot
+}
+
+void TM8_timers::siftUp(uint8_t i) {
+  while (i) {
+    uint8_t parent = (i - 1) / 2;
+    if (!earlier(heap[i], heap[parent])) break;
+    swap(i, parent);
+    i = parent;
+  }
+}
+
+void TM8_timers::siftDown(uint8_t i) {
+  for (;;) {
+    uint8_t first = i;
+    uint8_t l = 2 * i + 1;
+    uint8_t r = l + 1;
+    if (l < size && earlier(heap[l], heap[first])) first = l;
+    if (r < size && earlier(heap[r], heap[first])) first = r;
+    if (first == i) return;
+    swap(i, first);
+    i = first;
+  }
+}
+
+void TM8_timers::swap(uint8_t a, uint8_t b) {
+  TM8_timerEntry t = heap[a];
+  heap[a] = heap[b];
+  heap[b] = t;
+}
+
+/*
+the RTC alarm only fires on an exact match, so a deadline that's already past
+(or went past while it was being set) would never come. those are flagged right
+away instead and picked up by the next service()
+*/
+void TM8_timers::arm(void) {
+  if (!size) {
+    rtc->disableAlarm();
+    return;
+  }
+  rtc->setAlarmEpoch(heap[0].due);
+  rtc->enableAlarm(RTCZero::MATCH_YYMMDDHHMMSS);
+  if (isDue(heap[0].due, rtc->getEpoch())) {
+    fired = true;
+    Sleep.poke();
+  }
+}
+
+void TM8_timers::cue(uint8_t what) {
+  if (what & TIMER_CUE_BEEP) Buzzer.play(cueAlarm, BUZZER_PRI_ALARM); // plays on by itself
+  if (what & TIMER_CUE_LEDS) {
+    for (uint8_t i=0; i<LED_BAR_LEN; i++) {
+      Leds.set(LED_CH_BAR + i, LED_FULL);
+      Leds.fadeTo(LED_CH_BAR + i, 0, TIMER_CUE_MS);
+    }
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef _TM8_TIMER_H_
+#define _TM8_TIMER_H_
+
+#include <inttypes.h>
+
+class RTCZero;
+
+//----------------------------------------------------------------------------
+
+#define TIMER_MAX       8 // pending timers, add() fails past this
+#define TIMER_NONE      0 // never a valid id
+
+// what the watch does on its own when a timer fires, on top of the callback
+#define TIMER_CUE_NONE  0x00
+#define TIMER_CUE_BEEP  0x01 // cueAlarm on the buzzer, pre-empts anything but another alarm
+#define TIMER_CUE_LEDS  0x02 // lights the LED bar and fades it out
+
+#define TIMER_CUE_MS    600 // LED fade out
+
+//----------------------------------------------------------------------------
+
+typedef void (*TM8_timerFn)(uint8_t id);
+
+struct TM8_timerEntry
+{
+  uint32_t due; // RTC epoch seconds
+  uint32_t period; // seconds between repeats, 0 for one shot
+  TM8_timerFn fn;
+  uint8_t cue;
+  uint8_t id;
+};
+
+/*
+Timer service.
+Keeps every pending countdown, alarm and interval timer in a min-heap sorted by
+RTC epoch, and only programs the single RTCZero alarm for the earliest one.
+The RTC keeps running in STANDBY where millis() doesn't, so timers keep their
+place through the AOD's deep sleep; the alarm interrupt wakes the MCU and
+pushes EVENT_ALARM, then whoever owns the main loop calls service() to run the
+callbacks. Resolution is one second, like the RTC alarm.
+Deadlines follow the wall clock, setting the time moves them too.
+*/
+class TM8_timers
+{
+public:
+  void begin(RTCZero *clock);
+
+  uint8_t in(uint32_t secs, TM8_timerFn fn, uint8_t cue = TIMER_CUE_NONE); // one shot, returns the id or TIMER_NONE when full
+  uint8_t at(uint32_t epoch, TM8_timerFn fn, uint8_t cue = TIMER_CUE_NONE);
+  uint8_t every(uint32_t secs, TM8_timerFn fn, uint8_t cue = TIMER_CUE_NONE);
+  bool cancel(uint8_t id);
+  bool pending(uint8_t id);
+  uint32_t left(uint8_t id); // seconds to go, 0 if due or gone
+  uint8_t count(void) { return size; }
+
+  void service(void); // runs whatever is due and re-arms the alarm, cheap when nothing fired
+
+  volatile bool fired; // set by the alarm interrupt, cleared by service()
+
+private:
+  uint8_t add(uint32_t due, uint32_t period, TM8_timerFn fn, uint8_t cue);
+  uint8_t find(uint8_t id);
+  void removeAt(uint8_t i);
+  void siftUp(uint8_t i);
+  void siftDown(uint8_t i);
+  void swap(uint8_t a, uint8_t b);
+  void arm(void);
+  void cue(uint8_t what);
+
+  RTCZero *rtc;
+
+  TM8_timerEntry heap[TIMER_MAX];
+  uint8_t size;
+  uint8_t nextId;
+};
+
+extern TM8_timers Timers;
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_TIMER_H_
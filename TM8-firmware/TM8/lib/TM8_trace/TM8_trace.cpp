@@ -0,0 +1,38 @@
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+
+#include "TM8_trace.h"
+
+#include <Arduino.h>
+
+//----------------------------------------------------------------------------
+
+#if TRACE_ENABLED
+
+TM8_trace Trace;
+
+bool TM8_trace::flush(const char *const *names, uint8_t count) {
+  if (!Serial) return false; // detached, or nobody has the port open
+
+  if (lost) {
+    Serial.print("# trace lost ");
+    Serial.println(lost);
+    lost = 0;
+  }
+  while (used) {
+    const TM8_traceRecord &r = ring[(uint8_t)(head - used) & (TRACE_RING_LEN - 1)];
+    Serial.print(r.time);
+    Serial.print(',');
+    if (r.id < count) Serial.print(names[r.id]);
+    else Serial.print(r.id);
+    Serial.print(',');
+    Serial.print(r.a);
+    Serial.print(',');
+    Serial.println(r.b);
+    used--;
+  }
+  return true;
+}
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,70 @@
+#ifndef _TM8_TRACE_H_
+#define _TM8_TRACE_H_
+
+#include <inttypes.h>
+
+//----------------------------------------------------------------------------
+
+// build with -D TRACE_ENABLED=0 to compile every TRACE() out, ring and all
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED   1
+#endif
+
+#define TRACE_RING_LEN  64 // power of two, 16 bytes a record
+
+//----------------------------------------------------------------------------
+
+struct TM8_traceRecord
+{
+  uint32_t time; // millis()
+  int32_t a;
+  int32_t b;
+  uint8_t id; // index into the names given to flush()
+};
+
+/*
+Deferred debug trace.
+TRACE() drops a binary record into a RAM ring and returns, a handful of stores
+instead of a Serial.print() that formats digits and waits on the USB endpoint,
+which is usually detached anyway. The ring keeps the newest TRACE_RING_LEN
+records and counts what it had to overwrite.
+flush() turns the records into CSV lines, "ms,name,a,b", on the USB CDC
+Serial, but only once a host has the port open; until then they stay put. The
+ids are the caller's, flush() just looks them up in the name table it's given.
+Main loop only, no interrupt pushes to it.
+*/
+class TM8_trace
+{
+public:
+  void add(uint8_t id, uint32_t time, int32_t a, int32_t b) {
+    TM8_traceRecord &r = ring[head++ & (TRACE_RING_LEN - 1)];
+    r.time = time;
+    r.a = a;
+    r.b = b;
+    r.id = id;
+    if (used < TRACE_RING_LEN) used++;
+    else lost++;
+  }
+
+  bool flush(const char *const *names, uint8_t count); // over Serial, false when no host is listening
+
+  uint16_t lost; // records overwritten before they were flushed
+
+private:
+  TM8_traceRecord ring[TRACE_RING_LEN];
+  uint8_t head; // next slot to fill
+  uint8_t used;
+};
+
+#if TRACE_ENABLED
+extern TM8_trace Trace;
+#define TRACE(id, a, b)             Trace.add((id), millis(), (a), (b))
+#define TRACE_FLUSH(names, n)       Trace.flush((names), (n))
+#else
+#define TRACE(id, a, b)             ((void)0)
+#define TRACE_FLUSH(names, n)       ((void)0) // so don't build on flush()'s result outside #if TRACE_ENABLED
+#endif
+
+//----------------------------------------------------------------------------
+
+#endif // _TM8_TRACE_H_
@@ -23,6 +23,7 @@ extern "C" {
 
 #include <Arduino.h>
 #include <wiring_private.h>
+#include <TM8_clock.h>
 
 #ifdef USE_TINYUSB
 // For Serial when selecting TinyUSB
@@ -31,18 +32,49 @@ extern "C" {
 
 #include "Wire.h"
 
+// the SERCOM class keeps its registers to itself
+static Sercom * sercomRegs(SERCOM * s)
+{
+  SERCOM * const objs[] = { &sercom0, &sercom1, &sercom2, &sercom3, &sercom4, &sercom5 };
+  Sercom * const regs[] = { SERCOM0, SERCOM1, SERCOM2, SERCOM3, SERCOM4, SERCOM5 };
+  for (uint8_t i = 0; i < 6; i++) {
+    if (objs[i] == s) return regs[i];
+  }
+  return 0;
+}
+
+// open drain by hand: low drives, high lets the pullups have the line
+static void lineLow(uint8_t pin)
+{
+  digitalWrite(pin, LOW);
+  pinMode(pin, OUTPUT);
+}
+
+static void lineRelease(uint8_t pin)
+{
+  pinMode(pin, INPUT);
+}
+
 TwoWire::TwoWire(SERCOM * s, uint8_t pinSDA, uint8_t pinSCL)
 {
   this->sercom = s;
+  this->hw = sercomRegs(s);
   this->_uc_pinSDA=pinSDA;
   this->_uc_pinSCL=pinSCL;
   transmissionBegun = false;
+  clockHz = TWI_CLOCK;
+  running = false;
+  retries = WIRE_RETRIES;
+  timeoutUs = WIRE_TIMEOUT_US;
+  recovered = 0;
+  statsUsed = 0;
 }
 
 void TwoWire::begin(void) {
   //Master Mode
-  sercom->initMasterWIRE(TWI_CLOCK);
+  sercom->initMasterWIRE(clockHz);
   sercom->enableWIRE();
+  running = true;
 
   pinPeripheral(_uc_pinSDA, g_APinDescription[_uc_pinSDA].ulPinType);
   pinPeripheral(_uc_pinSCL, g_APinDescription[_uc_pinSCL].ulPinType);
@@ -58,12 +90,14 @@ void TwoWire::begin(uint8_t address, bool enableGeneralCall) {
 }
 
 void TwoWire::setClock(uint32_t baudrate) {
+  clockHz = baudrate;
   sercom->disableWIRE();
   sercom->initMasterWIRE(baudrate);
   sercom->enableWIRE();
 }
 
 void TwoWire::end() {
+  running = false;
   sercom->disableWIRE();
 }
 
@@ -74,32 +108,17 @@ uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool stopBit)
     return 0;
   }
 
-  size_t byteRead = 0;
-
-  rxBuffer.clear();
-
-  if(sercom->startTransmissionWIRE(address, WIRE_READ_FLAG))
-  {
-    // Read first data
-    rxBuffer.store_char(sercom->readDataWIRE());
-
-    // Connected to slave
-    for (byteRead = 1; byteRead < quantity; ++byteRead)
-    {
-      sercom->prepareAckBitWIRE();                          // Prepare Acknowledge
-      sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_READ); // Prepare the ACK command for the slave
-      rxBuffer.store_char(sercom->readDataWIRE());          // Read data and send the ACK
-    }
-    sercom->prepareNackBitWIRE();                           // Prepare NACK to stop slave transmission
-    //sercom->readDataWIRE();                               // Clear data register to send NACK
-
-    if (stopBit)
-    {
-      sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_STOP);   // Send Stop
-    }
-  }
-
-  return byteRead;
+  // only a NACKed address is read again. once a byte has been clocked out the
+  // slave has moved on, an auto-increment pointer or a FIFO won't give the same
+  // bytes twice, so the error goes back for the caller to redo pointer and read
+  uint8_t err;
+  uint8_t tries = 0;
+  uint32_t start = Clock.micros();
+  do {
+    err = readOnce(address, quantity, stopBit);
+  } while (again(address, err, tries, start, err == WIRE_ERR_NACK_ADDR));
+
+  return err ? 0 : quantity;
 }
 
 uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity)
@@ -121,34 +140,26 @@ void TwoWire::beginTransmission(uint8_t address) {
 //  2 : NACK on transmit of address
 //  3 : NACK on transmit of data
 //  4 : Other error
+//  5 : Timeout
 uint8_t TwoWire::endTransmission(bool stopBit)
 {
-  transmissionBegun = false ;
+  uint8_t data[256]; // a retry sends the same bytes again, txBuffer only gives them out once
+  size_t length = 0;
 
-  // Start I2C transmission
-  if ( !sercom->startTransmissionWIRE( txAddress, WIRE_WRITE_FLAG ) )
-  {
-    sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_STOP);
-    return 2 ;  // Address error
-  }
-
-  // Send all buffer
+  transmissionBegun = false ;
   while( txBuffer.available() )
   {
-    // Trying to send data
-    if ( !sercom->sendDataMasterWIRE( txBuffer.read_char() ) )
-    {
-      sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_STOP);
-      return 3 ;  // Nack or error
-    }
+    data[length++] = txBuffer.read_char();
   }
-  
-  if (stopBit)
-  {
-    sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_STOP);
-  }   
 
-  return 0;
+  uint8_t err;
+  uint8_t tries = 0;
+  uint32_t start = Clock.micros();
+  do {
+    err = writeOnce(data, length, stopBit);
+  } while (again(txAddress, err, tries, start));
+
+  return err;
 }
 
 uint8_t TwoWire::endTransmission()
@@ -214,6 +225,231 @@ void TwoWire::onRequest(void(*function)(void))
   onRequestCallback = function;
 }
 
+uint8_t TwoWire::startMaster(uint8_t address, bool read)
+{
+  // ended (TM8_power may have its clock off too), or whoever held the bus last
+  // never let go and waiting for idle would be forever
+  if ( !running || (!sercom->isBusIdleWIRE() && !sercom->isBusOwnerWIRE()) )
+  {
+    return WIRE_ERR_BUS;
+  }
+
+  hw->I2CM.ADDR.reg = (address << 1) | (read ? WIRE_READ_FLAG : WIRE_WRITE_FLAG);
+
+  // a read ends on SB once the slave ACKs, or on MB if it didn't
+  uint8_t err = waitFlag(read ? SERCOM_I2CM_INTFLAG_SB | SERCOM_I2CM_INTFLAG_MB : SERCOM_I2CM_INTFLAG_MB);
+  if ( err )
+  {
+    return err;
+  }
+  if ( hw->I2CM.STATUS.reg & (SERCOM_I2CM_STATUS_BUSERR | SERCOM_I2CM_STATUS_ARBLOST) )
+  {
+    return WIRE_ERR_BUS;
+  }
+  if ( hw->I2CM.STATUS.reg & SERCOM_I2CM_STATUS_RXNACK )
+  {
+    return WIRE_ERR_NACK_ADDR;
+  }
+  return 0;
+}
+
+uint8_t TwoWire::waitFlag(uint8_t flags)
+{
+  uint32_t start = Clock.micros();
+  while ( !(hw->I2CM.INTFLAG.reg & flags) )
+  {
+    if ( hw->I2CM.STATUS.reg & SERCOM_I2CM_STATUS_BUSERR )
+    {
+      return WIRE_ERR_BUS;
+    }
+    if ( Clock.micros() - start >= timeoutUs )
+    {
+      return WIRE_ERR_TIMEOUT;
+    }
+  }
+  return 0;
+}
+
+uint8_t TwoWire::writeOnce(const uint8_t *data, size_t length, bool stopBit)
+{
+  uint32_t start = Clock.micros();
+  size_t sent = 0;
+  uint8_t err = startMaster(txAddress, false);
+
+  while ( !err && sent < length )
+  {
+    hw->I2CM.DATA.reg = data[sent];
+    err = waitFlag(SERCOM_I2CM_INTFLAG_MB);
+    if ( !err && (hw->I2CM.STATUS.reg & SERCOM_I2CM_STATUS_RXNACK) )
+    {
+      err = WIRE_ERR_NACK_DATA;
+    }
+    if ( !err ) sent++;
+  }
+
+  if ( err || stopBit )
+  {
+    sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_STOP);
+  }
+  account(txAddress, err, sent, start);
+  return err;
+}
+
+uint8_t TwoWire::readOnce(uint8_t address, size_t quantity, bool stopBit)
+{
+  uint32_t start = Clock.micros();
+  rxBuffer.clear();
+
+  uint8_t err = startMaster(address, true);
+  if ( !err )
+  {
+    // Read first data
+    rxBuffer.store_char(hw->I2CM.DATA.reg);
+
+    // Connected to slave
+    for (size_t i = 1; !err && i < quantity; i++)
+    {
+      sercom->prepareAckBitWIRE();                          // Prepare Acknowledge
+      sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_READ); // Prepare the ACK command for the slave
+      err = waitFlag(SERCOM_I2CM_INTFLAG_SB);
+      if ( !err )
+      {
+        rxBuffer.store_char(hw->I2CM.DATA.reg);
+      }
+    }
+    sercom->prepareNackBitWIRE();                           // Prepare NACK to stop slave transmission
+  }
+
+  if ( err || stopBit )
+  {
+    sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_STOP);   // Send Stop
+  }
+  account(address, err, rxBuffer.available(), start);
+  return err;
+}
+
+// one attempt's bytes and bus time, timed up to the STOP
+void TwoWire::account(uint8_t address, uint8_t err, size_t bytes, uint32_t start)
+{
+  TwoWireStats *s = slot(address);
+  if ( !s ) return;
+
+  uint32_t us = Clock.micros() - start;
+  uint8_t bucket = 0;
+  while ( (us >> bucket) > 1 && bucket < WIRE_HIST_BUCKETS - 1 ) bucket++;
+
+  s->bytes += bytes;
+  s->busUs += us;
+  if ( s->hist[bucket] != 0xFFFF ) s->hist[bucket]++;
+  if ( err == WIRE_ERR_NACK_ADDR || err == WIRE_ERR_NACK_DATA ) s->nacks++;
+}
+
+uint8_t TwoWire::ping(uint8_t address)
+{
+  uint8_t err = startMaster(address, false);
+  sercom->prepareCommandBitsWire(WIRE_MASTER_ACT_STOP);
+  if ( (err == WIRE_ERR_BUS || err == WIRE_ERR_TIMEOUT) && running )
+  {
+    recoverBus(); // so the rest of a sweep still gets a working bus
+  }
+  return err;
+}
+
+/*
+called after every attempt, returns true to go again. timeouts and bus errors
+get the bus recovered first, NACKs (a busy EEPROM, a glitch) just a short wait.
+retry false recovers the bus all the same but ends the call there.
+once the call is over, either way, it lands in the address' counters
+*/
+bool TwoWire::again(uint8_t address, uint8_t err, uint8_t &tries, uint32_t start, bool retry)
+{
+  TwoWireStats *s = slot(address);
+
+  if ( (err == WIRE_ERR_BUS || err == WIRE_ERR_TIMEOUT) && running )
+  {
+    if ( s ) s->busFaults++;
+    recoverBus();
+  }
+  if ( err && retry && tries < retries && running )
+  {
+    delayMicroseconds(WIRE_BACKOFF_US << tries);
+    tries++;
+    if ( s ) s->retries++;
+    return true;
+  }
+
+  if ( s )
+  {
+    uint32_t us = Clock.micros() - start;
+    s->lastUs = us > 0xFFFF ? 0xFFFF : us;
+    if ( s->lastUs > s->maxUs ) s->maxUs = s->lastUs;
+    s->transfers++;
+    if ( err ) s->failures++;
+  }
+  return false;
+}
+
+/*
+a slave that lost count halfway through a byte holds SDA low and the bus never
+goes idle again. nine SCL pulses clock out whatever it thinks it's still
+sending, a STOP resets it, and the SERCOM starts over from begin()
+*/
+void TwoWire::recoverBus(void)
+{
+  sercom->disableWIRE();
+  lineRelease(_uc_pinSDA);
+  lineRelease(_uc_pinSCL);
+
+  for (uint8_t i = 0; i < 9; i++)
+  {
+    lineLow(_uc_pinSCL);
+    delayMicroseconds(WIRE_RECOVER_US);
+    lineRelease(_uc_pinSCL);
+    delayMicroseconds(WIRE_RECOVER_US);
+  }
+
+  // STOP: SDA rises while SCL is high
+  lineLow(_uc_pinSCL);
+  lineLow(_uc_pinSDA);
+  delayMicroseconds(WIRE_RECOVER_US);
+  lineRelease(_uc_pinSCL);
+  delayMicroseconds(WIRE_RECOVER_US);
+  lineRelease(_uc_pinSDA);
+  delayMicroseconds(WIRE_RECOVER_US);
+
+  begin();
+  recovered++;
+}
+
+TwoWireStats *TwoWire::slot(uint8_t address)
+{
+  for (uint8_t i = 0; i < statsUsed; i++)
+  {
+    if ( stats[i].address == address ) return &stats[i];
+  }
+  if ( statsUsed == WIRE_STATS_DEVICES ) return 0;
+
+  TwoWireStats *s = &stats[statsUsed++];
+  memset(s, 0, sizeof(*s));
+  s->address = address;
+  return s;
+}
+
+const TwoWireStats *TwoWire::statsFor(uint8_t address)
+{
+  for (uint8_t i = 0; i < statsUsed; i++)
+  {
+    if ( stats[i].address == address ) return &stats[i];
+  }
+  return 0;
+}
+
+void TwoWire::resetStats(void)
+{
+  statsUsed = 0;
+  recovered = 0;
+}
+
 void TwoWire::onService(void)
 {
   if ( sercom->isSlaveWIRE() )
@@ -29,6 +29,36 @@
  // WIRE_HAS_END means Wire has end()
 #define WIRE_HAS_END 1
 
+// endTransmission() results, 0 is success
+#define WIRE_ERR_LENGTH     1 // data too long
+#define WIRE_ERR_NACK_ADDR  2
+#define WIRE_ERR_NACK_DATA  3
+#define WIRE_ERR_BUS        4 // bus error, lost arbitration or a bus that never went idle
+#define WIRE_ERR_TIMEOUT    5
+
+// bus supervisor
+#define WIRE_TIMEOUT_US     2000 // per address/byte by default, plenty for clock stretching at 100kHz
+#define WIRE_RETRIES        2 // extra attempts after a failed transfer
+#define WIRE_BACKOFF_US     100 // before the first retry, doubles for each one after
+#define WIRE_RECOVER_US     5 // SCL half period while unsticking the bus
+#define WIRE_STATS_DEVICES  8 // addresses counted per bus
+#define WIRE_HIST_BUCKETS   12 // bucket n counts attempts of 2^n..2^(n+1)-1 us, the last one everything longer
+
+struct TwoWireStats
+{
+  uint8_t address;
+  uint32_t transfers; // endTransmission()/requestFrom() calls
+  uint32_t retries;
+  uint32_t failures; // still failing after the last retry
+  uint32_t busFaults; // attempts that timed out or hit a bus error
+  uint32_t bytes; // payload moved, either direction
+  uint32_t nacks; // attempts NACKed on the address or a data byte
+  uint32_t busUs; // START to STOP, every attempt
+  uint16_t lastUs; // the whole call, retries included
+  uint16_t maxUs;
+  uint16_t hist[WIRE_HIST_BUCKETS]; // attempts by START to STOP time
+};
+
 class TwoWire : public Stream
 {
   public:
@@ -37,6 +67,7 @@ class TwoWire : public Stream
     void begin(uint8_t, bool enableGeneralCall = false);
     void end();
     void setClock(uint32_t);
+    uint32_t getClock(void) { return clockHz; }
 
     void beginTransmission(uint8_t);
     uint8_t endTransmission(bool stopBit);
@@ -63,12 +94,43 @@ class TwoWire : public Stream
 
     void onService(void);
 
+    // master transfers are bounded by WIRE_TIMEOUT_US and retried with backoff,
+    // timeouts and bus errors recover the bus before the retry. reads are only
+    // retried when the address was NACKed, a read that failed partway returns 0
+    // and the caller has to write the register pointer again
+    void setRetries(uint8_t n) { retries = n; }
+    void setTimeout(uint16_t us) { timeoutUs = us; }
+    uint8_t ping(uint8_t address); // address only write, one attempt and not counted. for scanners
+    void recoverBus(void);
+    uint16_t recoveries(void) { return recovered; }
+    uint8_t statsCount(void) { return statsUsed; }
+    const TwoWireStats &statsAt(uint8_t i) { return stats[i]; }
+    const TwoWireStats *statsFor(uint8_t address);
+    void resetStats(void);
+
   private:
+    uint8_t startMaster(uint8_t address, bool read);
+    uint8_t waitFlag(uint8_t flags);
+    uint8_t writeOnce(const uint8_t *data, size_t length, bool stopBit);
+    uint8_t readOnce(uint8_t address, size_t quantity, bool stopBit);
+    void account(uint8_t address, uint8_t err, size_t bytes, uint32_t start);
+    bool again(uint8_t address, uint8_t err, uint8_t &tries, uint32_t start, bool retry = true);
+    TwoWireStats *slot(uint8_t address);
+
     SERCOM * sercom;
+    Sercom * hw; // sercom's registers, for the transfers that need a timeout
     uint8_t _uc_pinSDA;
     uint8_t _uc_pinSCL;
 
     bool transmissionBegun;
+    uint32_t clockHz; // kept so begin() and a core clock change can restore it
+
+    bool running; // master, between begin() and end()
+    uint8_t retries;
+    uint16_t timeoutUs;
+    uint16_t recovered;
+    TwoWireStats stats[WIRE_STATS_DEVICES];
+    uint8_t statsUsed;
 
     // RX Buffer
     RingBufferN<256> rxBuffer;
@@ -20,6 +20,12 @@
 #include <time.h>
 #include <Mouse.h>
 #include <Keyboard.h>
+#include <TM8_boot.h>
+#include <TM8_buzzer.h>
+#include <TM8_input.h>
+#include <TM8_task.h>
+#include <TM8_timer.h>
+#include <TM8_leds.h>
 
 //----------------------------------------------------------------------------
 TwoWire wireTwo(&sercom2, 4, 3); //set up second ssI2C bus
@@ -38,11 +44,6 @@ LCD specific defines
 #define CMD_BANK_SEL	0xF8
 #define CMD_NOBLINK		0x70
 #define CMD_BLINK		0x71
-#define DASH            10
-#define UNDERSCORE      11
-#define SPACE           12
-#define ASTERISK        39
-#define ALPHA_START     13
 #define HOLD_TIME   8
 
 /*
@@ -60,51 +61,7 @@ TM8 hardware definitions
 #define readBtn4 (PORT->Group[0].IN.reg & (1 << 12))
 
 //----------------------------------------------------------------------------
-uint8_t TM8_LED[5] = {7, A3, A1, 8, 5};
-
-static uint8_t Segs[] =
-{
-	0x6F, // 0x30 0
-	0x03, // 0x31 1
-	0x5D, // 0x32 2
-	0x57, // 0x33 3
-	0x33, // 0x34 4
-	0x76, // 0x35 5
-	0x7E, // 0x36 6
-	0x43, // 0x37 7
-	0x7F, // 0x38 8
-	0x77, // 0x39 9
-	0x10, //  -
-	0x04, //  _
-	0x00, //  space
-	0x7B, // A
-	0x3E, // b
-	0x6C, // C
-	0x1F, // d
-	0x7C, // E
-	0x78, // F
-	0x6E, // G
-	0x3A, // H
-	0x03, // I
-	0x0F, // J
-	0x3B, // K - can't do
-	0x2C, // L
-	0x5A, // M - can't do
-	0x6B, // n
-	0x6F, // O
-	0x79, // P
-	0x73, // Q
-	0x18, // r
-	0x76, // S
-	0x3C, // t
-	0x0E, // u
-	0x2F, // V
-	0x35, // W
-	0x2B, // X
-	0x37, // y
-	0x5D, // Z
-	0x01, // ° - use * to represent it in your string
-};
+uint8_t TM8_LED[5] = {0, 1, 2, 3, 4}; // Leds channels, shuffled by animTach()
 
 void TM8_util::Update(bool disp) // if disp is 0, left LCD. if 1, right LCD.
 {
@@ -124,8 +81,8 @@ void TM8_util::Update(bool disp) // if disp is 0, left LCD. if 1, right LCD.
     Wire.write(CMD_BANK_SEL);
 
 
-    if(Blink) Wire.write(CMD_BLINK);
-    else      Wire.write(CMD_NOBLINK);
+    if(Blink & 1) Wire.write(CMD_BLINK);
+    else          Wire.write(CMD_NOBLINK);
 
   #if 1
     data[0] = (digits[0] >> 4); // || LCD_BAR
@@ -152,8 +109,8 @@ void TM8_util::Update(bool disp) // if disp is 0, left LCD. if 1, right LCD.
     wireTwo.write(CMD_BANK_SEL);
 
 
-    if(Blink) wireTwo.write(CMD_BLINK);
-    else      wireTwo.write(CMD_NOBLINK);
+    if(Blink & 2) wireTwo.write(CMD_BLINK);
+    else          wireTwo.write(CMD_NOBLINK);
 
   #if 1
     data[0] = (digits[0] >> 4); // || LCD_BAR
@@ -179,10 +136,10 @@ void TM8_util::init_lcd(void)
 {
 	Blink = 0;
 
-	digits[0] = Segs[SPACE];
-	digits[1] = Segs[SPACE];
-	digits[2] = Segs[SPACE];
-	digits[3] = Segs[SPACE];
+	digits[0] = lcdSegs[LCD_CHAR_SPACE];
+	digits[1] = lcdSegs[LCD_CHAR_SPACE];
+	digits[2] = lcdSegs[LCD_CHAR_SPACE];
+	digits[3] = lcdSegs[LCD_CHAR_SPACE];
 
 	Wire.beginTransmission(I2C_ADDR);
 	Wire.write(CMD_MODE_SET);
@@ -220,20 +177,20 @@ void TM8_util::Command(uint8_t cmd, bool disp)
 	switch(cmd)
 	{
 		case LCD_BLINK_OFF :
-			Blink = 0;
+			blink(false, disp);
 			Update(disp);
 			break;
 
 		case LCD_BLINK_ON :
-			Blink = 1;
+			blink(true, disp);
 			Update(disp);
 			break;
 
 		case LCD_CLEAR :
-			digits[0] = Segs[SPACE];
-			digits[1] = Segs[SPACE];
-			digits[2] = Segs[SPACE];
-			digits[3] = Segs[SPACE];
+			digits[0] = lcdSegs[LCD_CHAR_SPACE];
+			digits[1] = lcdSegs[LCD_CHAR_SPACE];
+			digits[2] = lcdSegs[LCD_CHAR_SPACE];
+			digits[3] = lcdSegs[LCD_CHAR_SPACE];
 
 			Update(disp);
 			break;
@@ -243,26 +200,37 @@ void TM8_util::Command(uint8_t cmd, bool disp)
 	}
 }
 
+/*
+sets the panel's blink bit without sending anything, the next dispStr() etc.
+carries it in the same I2C frame as the digits. the CDM4101 does the blinking
+itself (CMD_BLINK is its fastest rate, about 2Hz), so the MCU is free to sleep
+*/
+void TM8_util::blink(bool on, bool disp)
+{
+	if(on) Blink |= 1 << disp;
+	else   Blink &= ~(1 << disp);
+}
+
 char TM8_util::ConvertChar(char c)
 {
-	if((c >= 'a') && (c <= 'z')) c = c - 'a' + ALPHA_START;
+	if((c >= 'a') && (c <= 'z')) c = c - 'a' + LCD_CHAR_ALPHA_START;
 	else
-		if((c >= 'A') && (c <= 'Z')) c = c - 'A' + ALPHA_START;
+		if((c >= 'A') && (c <= 'Z')) c = c - 'A' + LCD_CHAR_ALPHA_START;
 		else
 			if((c >= '0') && (c <= '9')) c = c - '0';
 			else
-				if(c == '-') c = DASH;
+				if(c == '-') c = LCD_CHAR_DASH;
 				else
-					if(c == '_') c = UNDERSCORE;
+					if(c == '_') c = LCD_CHAR_UNDERSCORE;
 					else
-						if(c == '*') c = ASTERISK;
-						else c = SPACE;
+						if(c == '*') c = LCD_CHAR_ASTERISK;
+						else c = LCD_CHAR_SPACE;
 	return c;
 }
 
 void TM8_util::dispChar(uint8_t index, char c, bool disp)
 {
-	digits[(int)index] = Segs[(int)(ConvertChar(c))];
+	digits[(int)index] = lcdSegs[(int)(ConvertChar(c))];
 	Update(disp);
 }
 
@@ -272,17 +240,24 @@ void TM8_util::dispCharRaw(uint8_t index, char c, bool disp)
 	Update(disp);
 }
 
+// shows a name encoded at compile time with lcdText(), no character conversion at runtime
+void TM8_util::dispText(const TM8_lcdText &t, bool disp)
+{
+	for(uint8_t i=0;i<LCD_NUM_DIGITS;i++) digits[i] = t.seg[i];
+	Update(disp);
+}
+
 void TM8_util::dispStr(const char *s, bool disp)
 {
 	uint8_t i,c;
 
-	for(i=0;i<LCD_NUM_DIGITS;i++) digits[i] = Segs[SPACE];
+	for(i=0;i<LCD_NUM_DIGITS;i++) digits[i] = lcdSegs[LCD_CHAR_SPACE];
 
 	i = 0;
 
 	while((i < 4) && s[i])
 	{
-		c = Segs[(int)(ConvertChar(s[i]))];
+		c = lcdSegs[(int)(ConvertChar(s[i]))];
 
 		digits[i] = c;
 		i++;
@@ -324,16 +299,14 @@ Little helper function for various animations
 void TM8_util::blinkGo(bool isGo) {
   for (int i=0; i<5; i++) {
     dispStr("    ", 1);
-    noTone(9);
     delay(30);
     for (int i=0; i<4; i++) {
       dispCharRaw(i, 0x54, 1);
     }
-    tone(9, random(1, 7) * 1000);
+    Buzzer.tone(random(1, 7) * 1000, 30);
     delay(30);
   }
   isGo ? dispStr(" GO ", 1) : dispStr("Err ", 1);
-  noTone(9);
   delay(500);
 }
 
@@ -372,7 +345,7 @@ void TM8_util::animTach() {
     buffer = TM8_LED[ledToLight]; // swap randomly selected LED with last array value.
     TM8_LED[ledToLight] = TM8_LED[i]; // randomly selected LED goes last in the array
     TM8_LED[i] = buffer; // last array element goes to where randomly selected LED was
-    digitalWrite(TM8_LED[i], 1); // light up randomly selected LED
+    Leds.fadeTo(TM8_LED[i], LED_FULL, 100); // light up randomly selected LED
     delay(100);
   }
   for (int i=0; i<7; i++) { // for each frame of tachInit[] animation
@@ -397,55 +370,42 @@ void TM8_util::animTach() {
     buffer= TM8_LED[ledToLight];
     TM8_LED[ledToLight] = TM8_LED[i];
     TM8_LED[i] = buffer;
-    digitalWrite(TM8_LED[i], 0);
+    Leds.fadeTo(TM8_LED[i], 0, 100);
     delay(100);
   }
 }
 
 /*
-bootup animation. Scans all I2C buses and devices. Checks for response
+bootup animation. Probes every device on both I2C buses and shows which ones answered
 */
 void TM8_util::sysCheck() {
   animTach(); // vintage tachometer animation
-  uint8_t deviceCount = 0; // total number of devices detected. Increments with each device detected. Should be 5.
-
-  dispStr("LCDR", 0);
-  wireTwo.beginTransmission(LCD_ADDRESS);
-  blinkGo(!Wire.endTransmission()); deviceCount++;
-
-  dispStr("LCDL", 0);
-  Wire.beginTransmission(LCD_ADDRESS);
-  blinkGo(!wireTwo.endTransmission()); deviceCount++;
-
-  dispStr("FUEL", 0);
-  Wire.beginTransmission(FUEL_ADDRESS);
-  blinkGo(!Wire.endTransmission()); deviceCount++;
-
-  dispStr("ACCL", 0);
-  wireTwo.beginTransmission(ACCEL_ADDRESS);
-  blinkGo(!wireTwo.endTransmission()); deviceCount++;
-
-  dispStr("TEMP", 0);
-  wireTwo.beginTransmission(BME_ADDRESS);
-  blinkGo(!wireTwo.endTransmission()); deviceCount++;
+  uint8_t found = Boot.probe();
+  uint8_t deviceCount = 0; // total number of devices detected, should be BOOT_DEVICES
+
+  for (uint8_t i=0; i<BOOT_DEVICES; i++) {
+    bool go = found & (1 << i);
+    dispStr(bootDevices[i].name, 0);
+    blinkGo(go);
+    deviceCount += go;
+  }
 
   delay(750);
-  if (deviceCount == 5) { // if all devices detected
+  if (deviceCount == BOOT_DEVICES) { // if all devices detected
     dispStr("", 1);
     dispStr("All ", 0);
-    tone(9, 2000, 100);
+    Buzzer.tone(2000, 100);
     delay(500);
     dispStr("Syst", 0);
     dispStr("ems", 1);
-    tone(9, 2000, 100);
+    Buzzer.tone(2000, 100);
     delay(500);
     dispStr("", 1);
     for (int i=0; i<7; i++) {
       dispStr(" GO ", 0);
-      tone(9, 4000);
+      Buzzer.tone(4000, 75);
       delay(75);
       dispStr("", 0);
-      noTone(9);
       delay(75);
     }
   } else { // if a different number of devices detected
@@ -462,101 +422,183 @@ void TM8_util::sysCheck() {
 
 // HID utilities. Mouse jiggler and screen lock shortcut.
 // exitBtn is the button used to exit mouse jiggler
-void TM8_util::HIDutils(uint8_t exitBtn) {
-  Mouse.begin();
-  Keyboard.begin();
-  dispStr("HID ", 0);
-  dispStr("util", 1);
-  uint32_t currentTime = millis();
-  while (millis() - currentTime <= 2000) {
-    if (!readBtn1) {
-      uint8_t shift = 5;
-      uint8_t del = 100;
-      while (digitalRead(exitBtn)) {
-        Mouse.move(shift, -shift, 0);
-        delay(del);
-        Mouse.move(shift, shift, 0);
-        delay(del);
-        Mouse.move(-shift, shift, 0);
-        delay(del);
-        Mouse.move(-shift, -shift, 0);
-        delay(del);
+/*
+HIDutils and pomodoro's start screen run as tasks so the pedometer and battery tasks keep
+going underneath. Task functions can't be members, they reach the LCDs through util.
+*/
+static TM8_util *util;
+static TM8_task utilTask;
+
+static uint8_t hidExit; // button that stops the jiggler
+static uint32_t hidStart;
+static uint8_t hidStep;
+static bool hidQuit;
+
+static const int8_t jiggle[4][2] = {{1, -1}, {1, 1}, {-1, 1}, {-1, -1}};
+
+// what's left of the 2 second window to pick a utility
+static uint32_t hidLeft(void) {
+  uint32_t passed = millis() - hidStart;
+  return passed < 2000 ? 2000 - passed : 0;
+}
+
+static uint8_t hidTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  hidStart = millis();
+  hidQuit = false;
+  for (;;) {
+    AWAIT_BUTTON(t, TASK_BTN(BTN1) | TASK_BTN(BTN2) | TASK_BTN(BTN4), hidLeft());
+    if (!t->gotEvent) break;
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN1) { // mouse jiggler
+      for (hidStep=0; ; hidStep=(hidStep + 1) % 4) {
+        Mouse.move(5 * jiggle[hidStep][0], 5 * jiggle[hidStep][1], 0);
+        AWAIT_BUTTON(t, TASK_BTN(hidExit), 100);
+        if (t->gotEvent && t->event.type == INPUT_PRESS) break;
       }
-      while(!digitalRead(exitBtn)); // so that exitBtn doesn't trigger something else immediately after exiting jiggler
-    } else if (!readBtn2) {
+      do { // so that exitBtn doesn't trigger something else immediately after exiting jiggler
+        AWAIT_BUTTON(t, TASK_BTN(hidExit), TASK_FOREVER);
+      } while (t->event.type != INPUT_RELEASE);
+    } else if (t->event.button == BTN2) { // lock screen
       Keyboard.press(KEY_LEFT_GUI);
       Keyboard.write('l');
       Keyboard.releaseAll();
-    }
-    if (!readBtn4) {
-      return;
+    } else {
+      hidQuit = true;
+      break;
     }
   }
-  digitalWrite(leftBL, 1);
+  TASK_END(t);
+}
+
+// exitBtn is a button index (BTN1-BTN4)
+void TM8_util::HIDutils(uint8_t exitBtn) {
+  Mouse.begin();
+  Keyboard.begin();
+  dispStr("HID ", 0);
+  dispStr("util", 1);
+  util = this;
+  hidExit = exitBtn;
+  Tasks.run(utilTask, hidTask);
+  if (!hidQuit) Leds.set(LED_CH_BL, LED_FULL);
   Mouse.end();
   Keyboard.end();
 }
 
-void TM8_util::pomodoro() {
-  uint32_t studyLen = 10000; // amount of time to "study" for (default 25 mins)
-  uint32_t restLen = 5000; // amount of time to rest (default 5 mins)
-  uint8_t warningTime = 5; // number of seconds to start warning before time's up
-  uint32_t millisLeft;
-  uint32_t secsLeft;
-  uint32_t minsLeft;
-  uint32_t startTime;
-  uint32_t stopTime;
-  dispStr("POMO", 0);
-  dispStr("DORO", 1);
-  uint8_t count = 4;
-  startTime = millis();
-  while (millis() - startTime <= 3000) {
-    if (!readBtn4) {
-      return;
+/*
+Pomodoro runs on the timer service instead of a task: the end of each phase is
+an RTC timer that beeps and starts the next one, so a session keeps going in the
+AOD's STANDBY and underneath any app. While one runs a 1 second tick wakes the
+AOD to redraw pomoShow(), nothing else is awake in between.
+*/
+#define POMO_OFF    0
+#define POMO_STUDY  1
+#define POMO_REST   2
+
+static uint8_t pomoPhase = POMO_OFF;
+static uint8_t pomoRound;
+static uint32_t pomoLen; // seconds in the current phase
+static uint8_t pomoEnd = TIMER_NONE; // timer ids
+static uint8_t pomoTick = TIMER_NONE;
+static uint32_t pomoConfirm; // millis() the start/stop screen gives up
+static bool pomoBackedOut;
+
+bool pomoValid(const TM8_pomoConfig &c) {
+  return c.magic == POMO_CONFIG_MAGIC && c.studyMins && c.studyMins <= POMO_MAX_MINS &&
+    c.restMins && c.restMins <= POMO_MAX_MINS && c.rounds;
+}
+
+static void pomoLeds(uint8_t lit) {
+  Leds.bar(lit, POMO_WARN_SECS);
+}
+
+static void pomoStop(void) {
+  Timers.cancel(pomoEnd);
+  Timers.cancel(pomoTick);
+  pomoEnd = pomoTick = TIMER_NONE;
+  pomoPhase = POMO_OFF;
+  pomoLeds(0);
+}
+
+static void pomoNext(uint8_t id);
+
+static void pomoStart(uint8_t phase, uint8_t mins) {
+  pomoPhase = phase;
+  pomoLen = (uint32_t)mins * 60;
+  pomoEnd = Timers.in(pomoLen, pomoNext, TIMER_CUE_BEEP | TIMER_CUE_LEDS);
+  if (pomoEnd == TIMER_NONE) pomoStop(); // timer service full
+}
+
+// phase over: study -> rest of the same round -> next round's study
+static void pomoNext(uint8_t id) {
+  pomoLeds(0);
+  if (pomoPhase == POMO_STUDY) {
+    pomoStart(POMO_REST, util->pomo.restMins);
+  } else if (++pomoRound < util->pomo.rounds) {
+    pomoStart(POMO_STUDY, util->pomo.studyMins);
+  } else {
+    pomoStop();
+  }
+}
+
+static uint32_t pomoConfirmLeft(void) {
+  int32_t left = pomoConfirm - millis();
+  return left > 0 ? left : 0;
+}
+
+static uint8_t pomoTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  util->dispStr("POMO", 0);
+  util->dispStr(pomoPhase == POMO_OFF ? "DORO" : "STOP", 1);
+  pomoConfirm = millis() + 3000;
+  pomoBackedOut = false;
+  do { // BTN4 within 3 seconds backs out
+    AWAIT_BUTTON(t, TASK_BTN(BTN4), pomoConfirmLeft());
+    if (t->gotEvent && t->event.type == INPUT_PRESS) {
+      pomoBackedOut = true;
+      TASK_EXIT(t);
     }
+  } while (t->gotEvent);
+  TASK_END(t);
+}
+
+void TM8_util::pomodoro() {
+  util = this;
+  if (!pomoValid(pomo)) pomo = pomoDefaults;
+  Tasks.run(utilTask, pomoTask);
+  if (pomoBackedOut) return;
+
+  if (pomoPhase != POMO_OFF) {
+    pomoStop();
+    return;
   }
-  for (int i=0; i<count; i++) {
-    startTime = millis();
-    stopTime = startTime + studyLen; // time to stop timer. Current time + timer length
-    while(stopTime - millis() - warningTime * 1000 <= studyLen) {
+  pomoRound = 0;
+  pomoStart(POMO_STUDY, pomo.studyMins);
+  if (pomoPhase != POMO_OFF) pomoTick = Timers.every(1, 0);
+}
+
+bool TM8_util::pomoActive(void) {
+  return pomoPhase != POMO_OFF;
+}
+
+/*
+a banner for the first POMO_BANNER_SECS of a phase, then mm:ss left on the left
+and the phase on the right. the time left comes from the RTC timer itself, so
+there's no millis() math to wrap and STANDBY doesn't throw it off
+*/
+void TM8_util::pomoShow(void) {
+  uint32_t left = Timers.left(pomoEnd);
+  if (pomoLen - left < POMO_BANNER_SECS) {
+    if (pomoPhase == POMO_STUDY) {
       dispStr("STUD", 0);
       dispStr("y   ", 1);
-      while(!readBtn3 && stopTime - millis() - warningTime * 1000 <= studyLen) {
-        millisLeft = stopTime - millis();
-        secsLeft = millisLeft / 1000;
-        minsLeft = secsLeft / 60;
-        millisLeft %= 1000;
-        secsLeft %= 60;
-        minsLeft %= 60;
-        dispDec(minsLeft * 100 + secsLeft, 0);
-        dispDec(millisLeft, 1);
-      }
-    }
-    for (int i=0; i<warningTime; i++) {
-      digitalWrite(TM8_LED[i], 1);
-      delay(1000);
-    }
-    tone(9, 4000, 1500);
-    dispStr("done", 0);
-    dispDec(i+1, 1);
-    delay(3000);
-    startTime = millis();
-    stopTime = startTime + restLen;
-    dispStr("PLAY", 0);
-    dispStr("TIME", 1);
-    while(stopTime - millis() <= restLen) {
-      millisLeft = stopTime - millis();
-      secsLeft = millisLeft / 1000;
-      minsLeft = secsLeft / 60;
-      millisLeft %= 1000;
-      secsLeft %= 60;
-      minsLeft %= 60;
-      dispDec(minsLeft * 100 + secsLeft, 0);
-      dispDec(millisLeft, 1);
+    } else {
+      dispStr("done", 0);
+      dispDec(pomoRound + 1, 1);
     }
-    tone(9, 4000, 1500);
-    dispStr("rest", 0);
-    dispStr("done", 1);
-    delay(3000);
+  } else {
+    dispDec((left / 60) * 100 + left % 60, 0);
+    dispStr(pomoPhase == POMO_STUDY ? "STUD" : "rest", 1);
   }
+  pomoLeds(left <= POMO_WARN_SECS ? POMO_WARN_SECS + 1 - left : 0);
 }
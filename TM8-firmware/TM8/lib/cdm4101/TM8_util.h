@@ -3,6 +3,8 @@
 
 #include <inttypes.h>
 
+class TwoWire;
+
 //----------------------------------------------------------------------------
 
 #define LCD_NUM_DIGITS  4
@@ -15,18 +17,125 @@
 #define LCD_BLINK_ON  7
 #define LCD_CLEAR     8
 
+//----------------------------------------------------------------------------
+// Segment patterns. Digits first, then the symbols below, then A-Z.
+
+#define LCD_CHAR_DASH         10
+#define LCD_CHAR_UNDERSCORE   11
+#define LCD_CHAR_SPACE        12
+#define LCD_CHAR_ALPHA_START  13
+#define LCD_CHAR_ASTERISK     39
+
+static constexpr uint8_t lcdSegs[] =
+{
+	0x6F, // 0x30 0
+	0x03, // 0x31 1
+	0x5D, // 0x32 2
+	0x57, // 0x33 3
+	0x33, // 0x34 4
+	0x76, // 0x35 5
+	0x7E, // 0x36 6
+	0x43, // 0x37 7
+	0x7F, // 0x38 8
+	0x77, // 0x39 9
+	0x10, //  -
+	0x04, //  _
+	0x00, //  space
+	0x7B, // A
+	0x3E, // b
+	0x6C, // C
+	0x1F, // d
+	0x7C, // E
+	0x78, // F
+	0x6E, // G
+	0x3A, // H
+	0x03, // I
+	0x0F, // J
+	0x3B, // K - can't do
+	0x2C, // L
+	0x5A, // M - can't do
+	0x6B, // n
+	0x6F, // O
+	0x79, // P
+	0x73, // Q
+	0x18, // r
+	0x76, // S
+	0x3C, // t
+	0x0E, // u
+	0x2F, // V
+	0x35, // W
+	0x2B, // X
+	0x37, // y
+	0x5D, // Z
+	0x01, // ° - use * to represent it in your string
+};
+
+// ConvertChar() + lcdSegs lookup, usable at compile time
+constexpr uint8_t lcdEncode(char c)
+{
+	return lcdSegs[(c >= 'a' && c <= 'z') ? c - 'a' + LCD_CHAR_ALPHA_START :
+		(c >= 'A' && c <= 'Z') ? c - 'A' + LCD_CHAR_ALPHA_START :
+		(c >= '0' && c <= '9') ? c - '0' :
+		c == '-' ? LCD_CHAR_DASH :
+		c == '_' ? LCD_CHAR_UNDERSCORE :
+		c == '*' ? LCD_CHAR_ASTERISK : LCD_CHAR_SPACE];
+}
+
+// 4 digits worth of segment patterns, see lcdText()
+struct TM8_lcdText
+{
+	uint8_t seg[LCD_NUM_DIGITS];
+};
+
+// i-th character of s, blank past the end like dispStr()
+constexpr uint8_t lcdEncodeAt(const char *s, uint8_t i)
+{
+	return !s[0] ? lcdSegs[LCD_CHAR_SPACE] : i == 0 ? lcdEncode(s[0]) : lcdEncodeAt(s + 1, i - 1);
+}
+
+// encodes a string for dispText() at compile time, so it can live in flash pre-converted
+constexpr TM8_lcdText lcdText(const char *s)
+{
+	return {{lcdEncodeAt(s, 0), lcdEncodeAt(s, 1), lcdEncodeAt(s, 2), lcdEncodeAt(s, 3)}};
+}
+
 //----------------------------------------------------------------------------
 
 #define TM8_NUM_LEDS 5
 
+//----------------------------------------------------------------------------
+// Pomodoro. Lengths in minutes, these are the defaults until settings are saved.
+
+#define POMO_STUDY_MINS   25
+#define POMO_REST_MINS    5
+#define POMO_ROUNDS       4
+#define POMO_MAX_MINS     99 // mm:ss has to fit on one LCD
+#define POMO_WARN_SECS    5  // one LED per second before a phase ends
+#define POMO_BANNER_SECS  3  // phase banner before the countdown shows
+#define POMO_CONFIG_MAGIC 0xA5
+
+struct TM8_pomoConfig
+{
+  uint8_t magic; // POMO_CONFIG_MAGIC, tells saved settings apart from blank EEPROM
+  uint8_t studyMins;
+  uint8_t restMins;
+  uint8_t rounds;
+};
+
+static constexpr TM8_pomoConfig pomoDefaults = {POMO_CONFIG_MAGIC, POMO_STUDY_MINS, POMO_REST_MINS, POMO_ROUNDS};
+
+bool pomoValid(const TM8_pomoConfig &c);
+
 class TM8_util
 {
 public:
 	void init_lcd(void);
 	void Command(uint8_t cmd, bool disp);
+  void blink(bool on, bool disp); // takes effect with the panel's next draw
 	void dispChar(uint8_t index, char c, bool disp);
   void dispCharRaw(uint8_t index, char c, bool disp);
 	void dispStr(const char *s, bool disp);
+  void dispText(const TM8_lcdText &t, bool disp);
 	void dispStrTimed(char *s, bool disp);
 	void dispDec(short n, bool disp);
   void blinkGo(bool isGo);
@@ -35,7 +144,11 @@ public:
   void scrambleAnim(uint8_t cnt, uint8_t animDelay);
   void sysCheck();
   void HIDutils(uint8_t btn);
-  void pomodoro();
+  void pomodoro(); // starts a session, or stops the one running
+  bool pomoActive(void);
+  void pomoShow(void); // current phase and time left, once a second is plenty
+
+  TM8_pomoConfig pomo;
 
   uint8_t digits[LCD_NUM_DIGITS];
   uint8_t leds[TM8_NUM_LEDS];
@@ -44,10 +157,12 @@ public:
 	void Update(bool);
 	char ConvertChar(char c);
 
-	uint8_t Blink;
+	uint8_t Blink; // bit 0 left panel, bit 1 right
 	uint8_t Ctr;
 };
 
+extern TwoWire wireTwo; // SERCOM2: right LCD, LIS3DH, BME680, EEPROM
+
 //----------------------------------------------------------------------------
 
 #endif // _TM8_UTIL_H_
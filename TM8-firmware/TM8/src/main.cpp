@@ -25,23 +25,86 @@ Button 4: top left. cancel/exit
 #include <SparkFun_External_EEPROM.h>
 #include <time.h>
 #include <TM8_util.h>
+#include <TM8_battery.h>
+#include <TM8_accel.h>
+#include <TM8_steps.h>
+#include <TM8_sleep.h>
+#include <TM8_fft.h>
+#include <TM8_gmeter.h>
+#include <TM8_input.h>
+#include <TM8_apps.h>
+#include <TM8_power.h>
+#include <TM8_clock.h>
+#include <TM8_task.h>
+#include <TM8_timer.h>
+#include <TM8_events.h>
+#include <TM8_trace.h>
+#include <TM8_boot.h>
+#include <TM8_buzzer.h>
+#include <TM8_leds.h>
 
 #define INACTIVITY_TIMEOUT 2000 // inactivity threshold of 2 seconds
 #define BUTTON_DELAY 100 // delay between button readings for scrolling, long press, etc.
+#define FRAME_MS 10 // chronograph redraw period, the LCD can't show faster than that anyway
 #define LCD_ADDRESS 0x38
 #define FUEL_ADDRESS 0x36
 #define ACCEL_ADDRESS 0x18
 #define BME_ADDRESS 0x76
 #define ROM_ADDRESS 0x50
 
-TwoWire wire1(&sercom2, 4, 3); // new Wire object to set up second I2C port on SERCOM 2
+// main menu apps. build with -D APP_xxx=0 to leave one out, the linker drops its code too
+#ifndef APP_CHRO
+#define APP_CHRO 1
+#endif
+#ifndef APP_DATA
+#define APP_DATA 1
+#endif
+#ifndef APP_ADJU
+#define APP_ADJU 1
+#endif
+#ifndef APP_PRTY
+#define APP_PRTY 1
+#endif
+#ifndef APP_SENS
+#define APP_SENS 1
+#endif
+#ifndef APP_RACE
+#define APP_RACE 1
+#endif
+#ifndef APP_FLSH
+#define APP_FLSH 1
+#endif
+#ifndef APP_GAME
+#define APP_GAME 1
+#endif
+#ifndef APP_TACH
+#define APP_TACH 1
+#endif
+#ifndef APP_BUS
+#define APP_BUS 1
+#endif
+#ifndef APP_SCAN
+#define APP_SCAN 1
+#endif
+
+// TRACE() ids, flushed as traceNames[id] by the data app
+#define TRACE_CHRO_SPLIT 0 // a: split number, b: split mm'ss"mmm
+#define TRACE_CHRO_VIEW 1 // a: record shown, b: its split
+#define TRACE_RACE_VIEW 2 // a: record shown, b: its split
+#define TRACE_IDS 3
+
+TwoWire &wire1 = wireTwo; // second I2C port on SERCOM 2, one object with the right LCD's so begin()/end() and the stats cover the whole bus
 RTCZero rtc; // RTC object
 Adafruit_MAX17048 fuel;
 LIS3DH accel(I2C_MODE, 0x18);
+TM8_accel lis(&wire1, ACCEL_ADDRESS); // register level LIS3DH access for burst reads
+TM8_steps pedometer;
+TM8_gmeter gmeter; // per lap G stats for raceChrono()
 Bme68x bme;
 bme68xData BMEData;
 ExternalEEPROM rom;
 TM8_util TM8;
+TM8_battery battery; // cached fuel gauge readings
 
 // I found after lots of trial and error this is the only way to get TM8 to read PA12
 // without the whole thing freezing or acting up
@@ -55,32 +118,20 @@ const uint8_t btn1 = 2; // top left button
 const uint8_t btn2 = 38; // bottom left button
 const uint8_t btn3 = 24; // top right button
 const uint8_t btn4 = 22; // bottom right button
+const uint8_t buttons[4] = {btn1, btn2, btn3, btn4}; // in BTN1..BTN4 order for Input
+
+const uint8_t fuelAlrt = 23; // MAX17048 ALRT, PB10
+const uint8_t accelInt = 42; // LIS3DH INT2, PA03 (AREF)
 
 const uint8_t leftBL = 26; // left backlight (red)
 const uint8_t rightBL = 3; // right backlight (red)
 
-uint8_t leds[5] = {7, A3, A1, 8, 5};
-
-bool menuActive = false; // main Menu ISR handler variable,
-// becomes true when main menu is opened and false when menu's over
-
-bool showDateActive = false; // interrupt for showing date on home screen.
-// triggered by BTN1
-
-bool btn2IntActive = false; // ISR handler for BTN2
-bool btn4IntActive = false; // ISR handler for BTN4
-
-bool splitActive = false; // ISR handler variable for recording splits in chronograph
+const uint8_t ledPins[] = {7, A3, A1, 8, 5, 6, leftBL}; // Leds channels: status LEDs, flashlight, backlight
 
 bool dispMode = 1; // 0 for wakeToCheck, 1 for AOD
 
-// list of programs in main menu 8 elements long with each element 5 bytes (4 bytes + line end)
-// first program is "quit", gets called when mainMenu() quits from no activity. Returns to main() loop.
-char mainPrograms[9][5] = {"quit", "Chro", "data", "Adju", "prty", "sens", "Race", "Flsh", "game"};
 char daysOfTheWeek[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
 
-uint8_t numPrograms = sizeof(mainPrograms) / sizeof(mainPrograms[0]);
-
 // RTC time variables
 uint8_t seconds = 0;
 uint8_t minutes = 0;
@@ -93,125 +144,232 @@ uint8_t day = 29;
 uint8_t temp = 0;
 
 /*
-Main menu interrupt handler.
-When ISR is invoked, it simply changes menuActive to true and goes right back to main().
-ISR is kept as short as possible to maintain high clock accuracy. Simply,
-Interrupt called -> menuActive becomes true -> main() detects menuActive == true and runs mainMenu() -> menuActive turns false again
+Home screen button handlers.
+ISRs are kept as short as possible: each one just queues a timestamped event,
+the home screen loop pops them in order and decides what to do.
+BTN3 opens the menu, BTN1 shows the date, BTN2 the HID utilities, BTN4 the pomodoro
 */
 void menuInt() {
-  menuActive = true;
+  Events.push(EVENT_BUTTON, BTN3);
 }
 
 void showDateInt() {
-  showDateActive = true;
+  Events.push(EVENT_BUTTON, BTN1);
 }
 
 void btn2Int() {
-  btn2IntActive = true;
+  Events.push(EVENT_BUTTON, BTN2);
 }
 
 void btn4Int() {
-  btn4IntActive = true;
+  Events.push(EVENT_BUTTON, BTN4);
+}
+
+// LIS3DH INT2: raise or double tap
+void gestureInt() {
+  Events.push(EVENT_GESTURE);
+}
+
+// MAX17048 ALRT: SoC moved 1% or voltage crossed a threshold
+void fuelAlertInt() {
+  battery.alertPending = true;
+  Events.push(EVENT_FUEL);
+}
+
+uint8_t stepMinute; // RTC minute/day the pedometer last booked
+uint8_t stepDay;
+
+// default FIFO consumer, runs the step counter on every batch
+void countSteps(const TM8_accelSample *batch, uint8_t n) {
+  for (int i=0; i<n; i++) {
+    pedometer.feed(batch[i].x, batch[i].y, batch[i].z);
+  }
+}
+
+// books activity minutes and rolls the totals over at midnight
+void stepsTick() {
+  if (rtc.getMinutes() != stepMinute) {
+    stepMinute = rtc.getMinutes();
+    pedometer.minuteTick();
+  }
+  if (rtc.getDay() != stepDay) {
+    stepDay = rtc.getDay();
+    pedometer.resetDay();
+  }
+}
+
+// default accelerometer setup: 50Hz low power, wake gestures, pedometer on the FIFO
+void accelDefault() {
+  lis.gestureBegin();
+  lis.fifoBegin(30, countSteps); // one wake every 600ms
+}
+
+// power manager hooks for the chips on wire1/Wire, see setup()
+void accelOff() {
+  lis.fifoEnd();
+  lis.gestureEnd();
+  lis.powerDown();
+}
+
+void bmeOff() {
+  bme.setOpMode(BME68X_SLEEP_MODE); // forced mode goes back to sleep by itself, this also covers a read left half done
+}
+
+void fuelOn() {
+  battery.wake();
 }
 
-// ISR for recording splits in chronograph
-void recordSplitInt() {
-  splitActive = true;
+void fuelOff() {
+  battery.hibernate();
+}
+
+void usbOn() {
+  Clock.set(CLOCK_48MHZ); // USB only runs off the DFLL
+  USBDevice.attach();
+}
+
+void usbOff() {
+  USBDevice.detach();
+}
+
+// background tasks, they keep the watch's own bookkeeping going while a task based app runs
+TM8_task stepsBg;
+TM8_task batteryBg;
+TM8_task timersBg;
+
+bool stepsBatchReady() {
+  return lis.fifoReady();
+}
+
+uint8_t stepsTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    AWAIT_BUS(t, stepsBatchReady, lis.batchPeriod());
+    lis.service();
+    stepsTick();
+  }
+  TASK_END(t);
+}
+
+uint8_t batteryTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    AWAIT_SLEEP_MS(t, 1000);
+    battery.update(rtc.getEpoch()); // only hits I2C on ALRT or every BATT_REFRESH_SECS
+  }
+  TASK_END(t);
+}
+
+// the RTC alarm pokes the scheduler, timers fire inside apps too
+uint8_t timersTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    AWAIT_UNTIL(t, Timers.fired);
+    Timers.service();
+  }
+  TASK_END(t);
 }
 
 uint8_t getDayOfWeek(uint16_t y, uint16_t m, uint16_t d) {
   return (d+=m<3?y--:y-2,23*m/9+d+4+y/4-y/100+y/400)%7;
 }
 
+/*
+Value entry widget.
+BTN1 counts up, BTN2 counts down, both wrap around within min-max.
+Holding either one keeps stepping and speeds up the longer it's held: 1Hz, then 5Hz, then 20Hz.
+The LCD is only redrawn when the value actually changes, the MCU idles between ticks.
+BTN3 accepts, BTN4 or timeout ms without any input cancels (timeout 0 waits forever).
+returns 1 if the value was accepted
+*/
+#define ENTRY_SLOW_MS     1000 // repeat interval right after the long press
+#define ENTRY_MID_MS      200
+#define ENTRY_FAST_MS     50
+#define ENTRY_SLOW_TICKS  2  // 1Hz steps before going to 5Hz
+#define ENTRY_MID_TICKS   10 // 5Hz steps before going to 20Hz
+
+bool enterValue(uint8_t &value, uint8_t min, uint8_t max, void (*draw)(uint8_t), uint32_t timeout) {
+  TM8_inputEvent e;
+  TM8_inputTiming saved = Input.timing;
+  uint8_t ticks = 0;
+  bool accepted = 0;
+  if (value < min || value > max) value = min;
+  Input.flush();
+  draw(value);
+  while (Input.wait(e, timeout ? timeout : 0xFFFFFFFF)) {
+    if (e.type == INPUT_PRESS && e.button == BTN3) {
+      accepted = 1;
+      break;
+    }
+    if (e.type == INPUT_PRESS && e.button == BTN4) break;
+    if (e.button != BTN1 && e.button != BTN2) continue;
+    if (e.type == INPUT_PRESS) { // fresh press, start over at 1Hz
+      ticks = 0;
+      Input.timing.repeatMs = ENTRY_SLOW_MS;
+    } else if (e.type == INPUT_REPEAT) {
+      ticks++;
+      if (ticks == ENTRY_SLOW_TICKS) Input.timing.repeatMs = ENTRY_MID_MS;
+      else if (ticks == ENTRY_SLOW_TICKS + ENTRY_MID_TICKS) Input.timing.repeatMs = ENTRY_FAST_MS;
+    } else if (e.type != INPUT_LONG) {
+      continue;
+    }
+    uint8_t old = value;
+    if (e.button == BTN1) value = value >= max ? min : value + 1;
+    else value = value <= min ? max : value - 1;
+    if (value != old) draw(value);
+  }
+  Input.setTiming(saved);
+  return accepted;
+}
+
+// enterValue() renderers
+void drawEntryDec(uint8_t v) {
+  TM8.dispDec(v, 0);
+}
+
+void drawEntryAmPm(uint8_t v) {
+  TM8.dispStr(v ? " PM " : " AM ", 0);
+}
+
+// hardware blink on both LCDs, sent along with the next thing each one draws
+void blinkBoth(bool on) {
+  TM8.blink(on, 0);
+  TM8.blink(on, 1);
+}
+
 /*
 Sets the time.
-returns 0 in case of an error (hours > 23 or minutes > 59) but this shouldn't happen.
-bool ampm is 0 for AM, 1 for PM
+returns 0 if cancelled with BTN4 or left alone on the hour screen for 3 seconds.
+ampm is 0 for AM, 1 for PM
 Automagically detects 12H/24H format and if user inputs in 12H format, asks for AM/PM as well
 */
 bool setTime() {
-  uint8_t hourTens = 0; // hour tens digit
-  uint8_t hourOnes = 0; // hour ones digit
-  uint8_t minuteTens = 0; // minute tens digit
-  uint8_t minuteOnes = 0; // minute ones digit
-  bool ampm = 0; // 0 for AM, 1 for PM
+  uint8_t hours = rtc.getHours(); // start from the current time, usually only a few steps away
+  uint8_t minutes = rtc.getMinutes();
+  uint8_t ampm = 0; // 0 for AM, 1 for PM
   TM8.dispStr("hour", 1); // indicate hour set mode
-  uint32_t currentTime = millis();
-  while(readBtn3 && millis() - currentTime <= 3000) { // until btn4 is pressed
-    TM8.dispDec(hourTens * 10 + hourOnes, 0); // display hour value to set
-    if (!readBtn1) { // btn1 increments tens digit
-      hourTens++;
-      if (hourTens > 2 || hourTens * 10 + hourOnes > 23) { // prevent overflow to stay within 0-23
-        hourTens = 0;
-      }
-      currentTime = millis();
-      delay(BUTTON_DELAY);
-    }
-    if (!readBtn2) { // btn2 increments ones digit
-      hourOnes++;
-      if (hourOnes > 9 || hourTens * 10 + hourOnes > 23) { // prevent overflow to stay within 0-23
-        hourOnes = 0;
-      }
-      currentTime = millis();
-      delay(BUTTON_DELAY);
-    }
-    if (!readBtn4) { // exit function for when triggered by mistake
-      return 0;
-    }
-    if (millis() - currentTime > 3000) {
-      return 0;
-    }
+  if (!enterValue(hours, 0, 23, drawEntryDec, 3000)) { // exit function for when triggered by mistake
+    return 0;
   }
   TM8.dispStr("hour", 0); // confirm hour has been set
   TM8.dispStr(" set", 1);
-  delay(750);
+  Sleep.delay(750);
   TM8.dispStr(" min", 1); // indicate minute set mode
-  while(readBtn3) { // until btn4 is pressed
-    TM8.dispDec(minuteTens * 10 + minuteOnes, 0); // display minute value to set
-    if (!readBtn1) { // btn1 increments tens digit
-      minuteTens++;
-      if (minuteTens > 5 || minuteTens * 10 + minuteOnes > 59) { // prevent overflow to stay within 0-59
-        minuteTens = 0;
-      }
-      delay(BUTTON_DELAY);
-    }
-    if (!readBtn2) { // btn2 increments ones digit
-      minuteOnes++;
-      if (minuteOnes > 9 || minuteTens * 10 + minuteOnes > 59) { // prevent overflow to stay within 0-59
-        minuteOnes = 0;
-      }
-      delay(BUTTON_DELAY);
-    }
-  }
-  uint8_t hours = hourTens * 10 + hourOnes; // compute hour and minute values from selection
-  uint8_t minutes = minuteTens * 10 + minuteOnes;
-  if (hours > 23 || minutes > 59) { // error handling if hour/min values are beyond acceptable range, shouldn't happen tho
-    TM8.dispStr(" Err", 0);
-    TM8.dispStr("or  ", 1);
-    delay(1000);
-    return 0; // quit setTime()
+  if (!enterValue(minutes, 0, 59, drawEntryDec, 0)) {
+    return 0;
   }
   // for some reason, doesn't work properly without the next three lines
   TM8.dispDec(hours, 0);
   TM8.dispDec(minutes, 1);
-  delay(2000);
+  Sleep.delay(2000);
   if (hours > 12) { // if hour is set above 12, automatically set to PM
     ampm = 1;
   } else if (hours == 0) { // if hour is set to 0, automatically set to AM
     ampm = 0;
   } else if (hours <= 12) { // if hour is in 12H format(1-12), ask for AM/PM
-    while(readBtn3) {
-      if (ampm) {
-        TM8.dispStr(" PM ", 0);
-      } else {
-        TM8.dispStr(" AM ", 0);
-      }
-      if (!readBtn1) { // btn1 sets time to AM
-        ampm = 0; 
-      }
-      if (!readBtn2) { // btn2 sets to PM
-        ampm = 1;
-      }
+    TM8.dispStr("", 1);
+    if (!enterValue(ampm, 0, 1, drawEntryAmPm, 0)) {
+      return 0;
     }
   }
 
@@ -224,161 +382,117 @@ bool setTime() {
   }
   rtc.setMinutes(minutes);
   rtc.setSeconds(0);
+  blinkBoth(true); // the LCDs blink it themselves, one frame each
   TM8.dispStr("time", 0);
   TM8.dispStr(" set", 1);
-  delay(1000);
-  for (int i=0; i<3; i++) {
-    TM8.dispStr("", 0);
-    TM8.dispStr("", 1);
-    delay(50);
-    TM8.dispStr("time", 0);
-    TM8.dispStr("set", 1);
-    delay(50);
-  }
+  Sleep.delay(1500);
+  blinkBoth(false); // off with whatever draws next
   return 1;
 }
 
 bool setDate() {
-  uint8_t month = 12; // month value
-  uint8_t dayTens = 2; // date tens digit
-  uint8_t dayOnes = 9; // date ones digit
+  uint8_t month = rtc.getMonth();
+  uint8_t date = rtc.getDay();
   TM8.dispStr("mnth", 1); // indicate month set mode
-  while(readBtn3) { // until btn4 is pressed
-    TM8.dispDec(month, 0); // display month value to set
-    if (!readBtn1) { // btn1 increments month
-      month++;
-      if (month > 12 || month < 1) { // prevent overflow to stay within 1-12
-        month = 1;
-      }
-      delay(BUTTON_DELAY);
-    }
-    if (!readBtn2) { // btn1 increments month
-      month--;
-      if (month > 12 || month < 1) { // prevent overflow to stay within 1-12
-        month = 12;
-      }
-      delay(BUTTON_DELAY);
-    }
-    if (!readBtn4) { // exit function for when triggered by mistake
-      return 0;
-    }
+  if (!enterValue(month, 1, 12, drawEntryDec, 0)) { // exit function for when triggered by mistake
+    return 0;
   }
   TM8.dispStr("mnth", 0); // confirm month has been set
   TM8.dispStr(" set", 1);
-  delay(750);
+  Sleep.delay(750);
   TM8.dispStr(" day", 1); // indicate day set mode
-  while(readBtn3) { // until btn4 is pressed
-    TM8.dispDec(dayTens * 10 + dayOnes, 0); // display day value to set
-    if (!readBtn1) { // btn1 increments tens digit
-      dayTens++;
-      if (dayTens > 3 || dayTens * 10 + dayOnes > 31) { // prevent overflow to stay within 0-31
-        dayTens = 0;
-      }
-      delay(BUTTON_DELAY);
-    }
-    if (!readBtn2) { // btn2 increments ones digit
-      dayOnes++;
-      if (dayOnes > 9 || dayTens * 10 + dayOnes > 31) { // prevent overflow to stay within 0-31
-        dayOnes = 0;
-      }
-      delay(BUTTON_DELAY);
-    }
-  }
-  uint8_t date = dayTens * 10 + dayOnes;
-  if (month > 12 || date > 31) { // error handling if hour/min values are beyond acceptable range, shouldn't happen tho
-    TM8.dispStr(" Err", 0);
-    TM8.dispStr("or  ", 1);
-    delay(1000);
-    return 0; // quit setTime()
+  if (!enterValue(date, 1, 31, drawEntryDec, 0)) {
+    return 0;
   }
   // for some reason, doesn't work properly without the next three lines
   TM8.dispDec(month, 0);
   TM8.dispDec(date, 1);
-  delay(2000);
+  Sleep.delay(2000);
   rtc.setDate(date, month, year);
+  blinkBoth(true); // the LCDs blink it themselves, one frame each
   TM8.dispStr("date", 0);
   TM8.dispStr(" set", 1);
-  delay(1000);
-  for (int i=0; i<3; i++) {
-    TM8.dispStr("", 0);
-    TM8.dispStr("", 1);
-    delay(50);
-    TM8.dispStr("date", 0);
-    TM8.dispStr("set", 1);
-    delay(50);
-  }
+  Sleep.delay(1500);
+  blinkBoth(false); // off with whatever draws next
   return 1;
 }
 
 uint32_t chronoSplits[10]; // 10-long split record
 
+TM8_task appTask; // the task based app in the foreground, one at a time
+
+uint32_t chronoStartTime; // millis() when the chronograph started
+uint8_t chronoSplitsCounter;
+
+// minutes/seconds on the left, milliseconds + split slot on the right
+void chronoShow(uint32_t elapsed) {
+  uint32_t chronoSeconds = elapsed / 1000; // compute elapsed time in seconds
+  uint32_t chronoMinutes = chronoSeconds / 60; // compute elapsed time in minutes
+  TM8.dispDec((chronoMinutes % 60) * 100 + chronoSeconds % 60, 0);
+  TM8.dispDec((elapsed % 1000) * 10 + chronoSplitsCounter, 1);
+}
+
 /*
 1/1000 second chronograph. Measures up to 59"59'999.
 BTN4: start/stop chronograph
 BTN3: record split. stops after all 10 slots are filled. record slot shown on rightmost digit.
-BTN1: show time. Frequent use hampers precision.
-Not using any interrupts to record splits cuz that caused problems where it would immediately record an interrupt
-right when the chrono started. same for race chrono.
+BTN1: show time while held.
+Start and splits use the timestamp of the button edge, so the 10ms frame
+the display runs at doesn't cost any precision.
 */
-bool chronoGraph() {
-  uint8_t chronoSplitsCounter = 0;
-  while(readBtn3) { // start when button 3 is pressed
-    TM8.dispStr("btn3", 0);
-    TM8.dispStr("strt", 1);
-    if (!readBtn4) { // press btn4 to quit
-      return 0;
-    }
-  } while(!readBtn3); // start on rising edge to prevent split recording immediately
-  uint32_t chronoStartTime = millis(); // time when chronograph started, in milliseconds
-  uint32_t chronoMillis; // declare variable for elapsed time in milliseconds
-  uint32_t chronoSeconds; // ...elapsed time in seconds
-  uint32_t chronoMinutes; // ...elapsed time in minutes
-  while(readBtn4) { // until button 4 is pressed (btn4 will quit chronograph)
-    chronoMillis = millis() - chronoStartTime; // compute elapsed time in milliseconds
-    chronoSeconds = chronoMillis / 1000; // compute elapsed time in seconds
-    chronoMinutes = chronoSeconds / 60; // compute elapsed time in minutes
-    chronoMillis %= 1000; // compute elapsed milliseconds
-    chronoSeconds %= 60; // compute elapsed seconds
-    chronoMinutes %= 60; // compute elapsed minutes
-    TM8.dispDec(chronoMinutes * 100 + chronoSeconds, 0); // display elapsed time on LCD
-    TM8.dispDec(chronoMillis * 10 + chronoSplitsCounter, 1); // display elapsed milliseconds + split record slot on the right
-    if (!readBtn3 && chronoSplitsCounter < 10) { // if button 3 is pressed and split record space is available
-      while(!readBtn3) {digitalWrite(leds[5], 1);} // show split time & light up LED5 while btn3 is depressed
-      digitalWrite(leds[5], 0); // turn off LED5
-      TM8.dispDec(chronoMinutes * 100 + chronoSeconds, 0); // display split time
-      TM8.dispDec(chronoMillis * 10 + chronoSplitsCounter, 1);
-      chronoSplits[chronoSplitsCounter] = chronoMinutes * 100000 + chronoSeconds * 1000 + chronoMillis;
-      Serial.print(chronoSplits[chronoSplitsCounter]); // debug messages
-      Serial.println(chronoSplitsCounter);
+uint8_t chronoTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  chronoSplitsCounter = 0;
+  TM8.dispStr("btn3", 0);
+  TM8.dispStr("strt", 1);
+  for (;;) { // start when button 3 is pressed
+    AWAIT_BUTTON(t, TASK_BTN(BTN3) | TASK_BTN(BTN4), TASK_FOREVER);
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN4) TASK_EXIT(t); // press btn4 to quit
+    break;
+  }
+  chronoStartTime = t->event.time;
+
+  for (;;) { // until button 4 is pressed (btn4 will quit chronograph)
+    chronoShow(millis() - chronoStartTime);
+    AWAIT_BUTTON(t, TASK_ALL_BTNS, FRAME_MS); // next frame, or sooner if a button moves
+    if (!t->gotEvent || t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN4) break;
+
+    if (t->event.button == BTN3 && chronoSplitsCounter < 10) { // if split record space is available
+      { // no locals can live across the AWAIT below
+        uint32_t split = t->event.time - chronoStartTime;
+        Leds.set(LED_CH_BAR + 4, LED_DIM); // show split time & light up LED5 while btn3 is depressed
+        chronoShow(split);
+        chronoSplits[chronoSplitsCounter] = (split / 60000 % 60) * 100000 + (split / 1000 % 60) * 1000 + split % 1000;
+      }
+      TRACE(TRACE_CHRO_SPLIT, chronoSplitsCounter, chronoSplits[chronoSplitsCounter]);
       chronoSplitsCounter++; // increment chronoSplitsCounter
-    }
-    if (!readBtn1) { // if btn1 is pressed
-      while(!readBtn1) {
+      do {
+        AWAIT_BUTTON(t, TASK_BTN(BTN3), TASK_FOREVER);
+      } while (t->event.type != INPUT_RELEASE);
+      Leds.set(LED_CH_BAR + 4, 0); // turn off LED5
+    } else if (t->event.button == BTN1) {
+      do {
         TM8.dispDec(rtc.getHours() * 100 + rtc.getMinutes(), 0); // display current time
         TM8.dispDec(rtc.getSeconds(), 1);
-      }
+        AWAIT_BUTTON(t, TASK_BTN(BTN1), 250);
+      } while (!t->gotEvent || t->event.type != INPUT_RELEASE);
     }
-    // if (!readBtn4) {
-    //   uint32_t millisBuffer = millis();
-    //   TM8.dispDec(chronoMinutes * 100 + chronoSeconds, 0); // display stopped chrono time
-    //   TM8.dispDec(chronoMillis * 10 + chronoSplitsCounter, 1);
-    //   while(readBtn4) {};
-    //   chronoStartTime = chronoStartTime - millisBuffer;
-    // }
   }
+
   // quit chronograph animation
-  delay(1000);
+  AWAIT_SLEEP_MS(t, 1000);
+  blinkBoth(true);
   TM8.dispStr("quit", 0);
   TM8.dispStr("chro", 1);
-  delay(1000);
-  for (int i=0; i<3; i++) {
-    TM8.dispStr("quit", 0);
-    TM8.dispStr("chro", 1);
-    delay(75);
-    TM8.dispStr("", 0);
-    TM8.dispStr("", 1);
-    delay(75);
-  }
+  AWAIT_SLEEP_MS(t, 1500);
+  blinkBoth(false);
+  TASK_END(t);
+}
+
+bool chronoGraph() {
+  Tasks.run(appTask, chronoTask);
   return 0;
 }
 
@@ -394,142 +508,227 @@ float distances[12] {4.352, 3.600, 12.944, 2.074, 3.608};
 
 uint32_t raceSplits[100] = {};
 uint16_t averageSpeeds[100] = {};
+uint16_t raceLatPeak[100] = {}; // peak lateral G per split, milli-g
+uint16_t raceLonPeak[100] = {}; // peak longitudinal G per split, milli-g
+uint16_t raceLatRms[100] = {}; // RMS lateral G per split, milli-g
+uint16_t raceLonRms[100] = {}; // RMS longitudinal G per split, milli-g
 uint8_t trackSelection = 0;
 
+// enterValue() renderer for the track picker
+void drawTrack(uint8_t v) {
+  TM8.dispStr(tracks[v], 1);
+}
+
+// FIFO consumer for raceChrono()
+void raceCollect(const TM8_accelSample *batch, uint8_t n) {
+  gmeter.feed(batch, n);
+}
+
+/*
+drains the G FIFO once a batch is due. called between LCD frames, the LIS3DH keeps
+sampling on its own clock so the samples stay evenly spaced whatever the LCD is doing
+*/
+uint32_t raceLastDrain;
+void raceService() {
+  if (millis() - raceLastDrain >= lis.batchPeriod()) {
+    raceLastDrain = millis();
+    lis.service();
+  }
+}
+
+// ms to sleep, ms at most but no later than the next G batch
+uint32_t raceNap(uint32_t ms) {
+  int32_t due = raceLastDrain + lis.batchPeriod() - millis();
+  if (due < 0) due = 0;
+  return (uint32_t)due < ms ? due : ms;
+}
+
+uint8_t raceSplitsCounter;
+uint32_t raceStartTime; // millis() when the race chronograph started
+uint32_t raceSplitTime; // the split being shown, ms since the start
+uint32_t raceUntil; // end of an AWAIT_RACE_MS
+
+// AWAIT_SLEEP_MS that keeps the G FIFO from overflowing
+#define AWAIT_RACE_MS(t, ms) \
+  do { \
+    raceUntil = millis() + (ms); \
+    while ((int32_t)(raceUntil - millis()) > 0) { \
+      raceService(); \
+      AWAIT_SLEEP_MS(t, raceNap(raceUntil - millis())); \
+    } \
+  } while (0)
+
+// minutes/seconds on the left, milliseconds + split slot on the right
+void raceShow(uint32_t elapsed) {
+  uint32_t raceSeconds = elapsed / 1000;
+  uint32_t raceMinutes = raceSeconds / 60;
+  TM8.dispDec((raceMinutes % 60) * 100 + raceSeconds % 60, 0);
+  TM8.dispDec((elapsed % 1000) * 10 + raceSplitsCounter, 1);
+}
+
 /*
 Race chronograph. In addition to all features in the regular chronograph,
-also shows average speed per split.
+also shows average speed, then peak and then RMS lateral (left)/longitudinal (right) G
+per split, in g/100.
+G is sampled at 200Hz through the LIS3DH FIFO.
 Can only measure up to 9"59.999
 100-deep split record
+Like chronoTask(), start and splits are the timestamps of the BTN3 edges.
 */
-bool raceChrono() {
-  uint8_t raceSplitsCounter = 0;
-  while (readBtn3) {
-    TM8.dispStr("trck", 0);
-    TM8.dispStr(tracks[trackSelection], 1);
-    if (!readBtn2) {
-      trackSelection--;
-      if (trackSelection > 4) trackSelection = 4;
-      delay(BUTTON_DELAY);
-    }
-    else if (!readBtn1) {
-      trackSelection++;
-      if (trackSelection > 4) trackSelection = 0;
-      delay(BUTTON_DELAY);
-    }
-  } while(!readBtn3); // start on rising edge to prevent split recording immediately
-  delay(BUTTON_DELAY);
-  while(readBtn3) { // start when button 3 is pressed
-    TM8.dispStr("btn3", 0);
-    TM8.dispStr("strt", 1);
-    if (!readBtn4) { // press btn4 to quit
-      return 0;
-    }
-  } while(!readBtn3); // start on rising edge to prevent split recording immediately
-  uint32_t raceStartTime = millis(); // time when chronograph started, in milliseconds
-  uint32_t raceMillis; // declare variable for elapsed time in milliseconds
-  uint32_t raceSeconds; // ...elapsed time in seconds
-  uint32_t raceMinutes; // ...elapsed time in minutes
-  while(readBtn4) { // until button 4 is pressed (btn4 will quit chronograph)
-    raceMillis = millis() - raceStartTime; // compute elapsed time in milliseconds
-    raceSeconds = raceMillis / 1000; // compute elapsed time in seconds
-    raceMinutes = raceSeconds / 60; // compute elapsed time in minutes
-    raceMillis %= 1000; // compute elapsed milliseconds
-    raceSeconds %= 60; // compute elapsed seconds
-    raceMinutes %= 60; // compute elapsed minutes
-    TM8.dispDec(raceMinutes * 100 + raceSeconds, 0); // display elapsed time on LCD
-    TM8.dispDec(raceMillis * 10 + raceSplitsCounter, 1); // display elapsed milliseconds + split record slot on the right
-    if (!readBtn3 && raceSplitsCounter < 100) { // if button 3 is pressed and split record space is available.
-      while(!readBtn3) {
-        digitalWrite(leds[5], 1); // show split time & light up LED5 while btn3 is depressed
-        TM8.dispDec(raceMinutes * 100 + raceSeconds, 0); // display split time
-        TM8.dispDec(raceMillis, 1);
+uint8_t raceTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  TM8.dispStr("btn3", 0);
+  TM8.dispStr("strt", 1);
+  for (;;) { // start when button 3 is pressed
+    AWAIT_BUTTON(t, TASK_BTN(BTN3) | TASK_BTN(BTN4), TASK_FOREVER);
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN4) TASK_EXIT(t); // press btn4 to quit
+    break;
+  }
+  raceStartTime = t->event.time;
+  raceSplitsCounter = 0;
+
+  wire1.setClock(400000); // a 16 sample drain takes 2.5ms instead of 10
+  lis.gestureEnd(); // at 200Hz the tap and raise thresholds would only flood the event ring
+  lis.begin(ACCEL_ODR_200, 4, ACCEL_MODE_HR);
+  lis.fifoBegin(16, raceCollect); // 80ms batches, 160ms of headroom
+  gmeter.reset();
+  raceLastDrain = millis();
+
+  for (;;) { // until button 4 is pressed (btn4 will quit chronograph)
+    raceService();
+    raceShow(millis() - raceStartTime);
+    AWAIT_BUTTON(t, TASK_ALL_BTNS, FRAME_MS); // next frame, or sooner if a button moves
+    if (!t->gotEvent || t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN4) break;
+
+    if (t->event.button == BTN3 && raceSplitsCounter < 100) { // if split record space is available
+      raceSplitTime = t->event.time - raceStartTime; // exact press time from the ISR
+      Leds.set(LED_CH_BAR + 4, LED_DIM); // show split time & light up LED5 while btn3 is depressed
+      TM8.dispDec((raceSplitTime / 60000 % 60) * 100 + raceSplitTime / 1000 % 60, 0);
+      TM8.dispDec(raceSplitTime % 1000, 1);
+      do {
+        raceService();
+        AWAIT_BUTTON(t, TASK_BTN(BTN3), raceNap(TASK_FOREVER));
+      } while (!t->gotEvent || t->event.type != INPUT_RELEASE);
+      Leds.set(LED_CH_BAR + 4, 0); // turn off LED5
+
+      { // no locals can live across the AWAIT below
+        lis.service(); // close the lap with everything sampled up to now
+        raceLatPeak[raceSplitsCounter] = gmeter.peak(gmeter.lat);
+        raceLonPeak[raceSplitsCounter] = gmeter.peak(gmeter.lon);
+        raceLatRms[raceSplitsCounter] = gmeter.rms(gmeter.lat);
+        raceLonRms[raceSplitsCounter] = gmeter.rms(gmeter.lon);
+        gmeter.reset();
+        float vavg = (distances[trackSelection]) / (float)((float)raceSplitTime / 1000 / 3600);
+        TM8.dispDec((int)(vavg), 0);
+        TM8.dispDec(((vavg - (int)(vavg)) * 100), 1);
+        raceSplits[raceSplitsCounter] = (raceSplitTime / 60000 % 60) * 100000 + (raceSplitTime / 1000 % 60) * 1000 + raceSplitTime % 1000;
+      }
+      AWAIT_RACE_MS(t, 1000);
+      {
+        char str[5];
+        sprintf(str, "%3dg", raceLatPeak[raceSplitsCounter] / 10);
+        TM8.dispStr(str, 0);
+        sprintf(str, "%3dg", raceLonPeak[raceSplitsCounter] / 10);
+        TM8.dispStr(str, 1);
+      }
+      AWAIT_RACE_MS(t, 1000);
+      {
+        char str[5];
+        sprintf(str, "%3dr", raceLatRms[raceSplitsCounter] / 10);
+        TM8.dispStr(str, 0);
+        sprintf(str, "%3dr", raceLonRms[raceSplitsCounter] / 10);
+        TM8.dispStr(str, 1);
       }
-      digitalWrite(leds[5], 0); // turn off LED5
-      float vavg = (distances[trackSelection]) / (float)((float)(millis() - raceStartTime) / 1000 / 3600);
-      TM8.dispDec((int)(vavg), 0);
-      TM8.dispDec(((vavg - (int)(vavg)) * 100), 1);
-      raceSplits[raceSplitsCounter] = raceMinutes * 100000 + raceSeconds * 1000 + raceMillis;
       raceSplitsCounter++; // increment raceSplitsCounter
-      delay(2000);
-    }
-    if (!readBtn1) {
-      while(!readBtn1) {
+      AWAIT_RACE_MS(t, 1000);
+    } else if (t->event.button == BTN1) {
+      do {
         TM8.dispDec(rtc.getHours() * 100 + rtc.getMinutes(), 0);
         TM8.dispDec(raceSplitsCounter, 1);
-      }
+        raceService();
+        AWAIT_BUTTON(t, TASK_BTN(BTN1), raceNap(250));
+      } while (!t->gotEvent || t->event.type != INPUT_RELEASE);
     }
   }
+  accelDefault(); // gestureBegin() re-arms tap and raise
+  wire1.setClock(100000);
+
   // quit chronograph animation
-  delay(1000);
+  AWAIT_SLEEP_MS(t, 1000);
+  blinkBoth(true);
   TM8.dispStr("quit", 0);
   TM8.dispStr("race", 1);
-  delay(1000);
-  for (int i=0; i<3; i++) {
-    TM8.dispStr("quit", 0);
-    TM8.dispStr("race", 1);
-    delay(75);
-    TM8.dispStr("", 0);
-    TM8.dispStr("", 1);
-    delay(75);
+  AWAIT_SLEEP_MS(t, 1500);
+  blinkBoth(false);
+  TASK_END(t);
+}
+
+bool raceChrono() {
+  TM8.dispStr("trck", 0);
+  if (!enterValue(trackSelection, 0, 4, drawTrack, 0)) { // BTN4 backs out
+    return 0;
   }
+  Tasks.run(appTask, raceTask);
   return 0;
 }
 
+#if TRACE_ENABLED
+const char *const traceNames[TRACE_IDS] = {"chro_split", "chro_view", "race_view"};
+#endif
+
+bool dataRace; // browsing the race's splits, not the chronograph's
+uint8_t dataAt;
+
+void dataShow() {
+  if (dataRace) {
+    TM8.dispDec(raceSplits[dataAt] / 100, 0);
+    TM8.dispDec((raceSplits[dataAt] % 100) * 100 + dataAt, 1);
+  } else {
+    TM8.dispDec(chronoSplits[dataAt] / 1000, 0);
+    TM8.dispDec((chronoSplits[dataAt] % 1000) * 10 + dataAt, 1);
+  }
+}
+
 /*
 retrieves chronograph split records
 first prompts whether to retrieve records from chrono or race
 user selects btn1 for chrono, btn3 for race
+then btn1/btn2 scroll (held: auto-repeat), btn4 quits
 */
-uint8_t chronoData() {
+uint8_t dataTask(TM8_task *t) {
+  TASK_BEGIN(t);
   TM8.dispStr("chro", 0); // prompt choice
   TM8.dispStr("race", 1);
-  uint8_t chronoCounter = 0;
-  uint8_t raceCounter = 0;
-  while (readBtn1 && readBtn3); // wait for either btn1 or btn3 input
-  if (!readBtn1) { // if chrono records selected
-    delay(BUTTON_DELAY);
-    while(readBtn4) {
-      TM8.dispDec(chronoSplits[chronoCounter] / 1000, 0);
-      TM8.dispDec((chronoSplits[chronoCounter] % 1000) * 10 + chronoCounter, 1);
-      if (!readBtn1) {
-        chronoCounter++;
-        if (chronoCounter > 9) {
-          chronoCounter = 0;
-        }
-        Serial.print(chronoSplits[chronoCounter]);
-        delay(BUTTON_DELAY);
-      } else if (!readBtn2) {
-        chronoCounter--;
-        if (chronoCounter > 9) {
-          chronoCounter = 9;
-        }
-        Serial.print(chronoSplits[chronoCounter]);
-        delay(BUTTON_DELAY);
-      }
-    }
-  } else if (!readBtn3) { // if race records selected
-    delay(BUTTON_DELAY);
-    while(readBtn4) {
-      TM8.dispDec(raceSplits[raceCounter] / 100, 0);
-      TM8.dispDec((raceSplits[raceCounter] % 100) * 100 + raceCounter, 1);
-      if (!readBtn1) {
-        raceCounter++;
-        if (raceCounter > 99) {
-          raceCounter = 0;
-        }
-        Serial.print(raceSplits[raceCounter]);
-        delay(BUTTON_DELAY);
-      } else if (!readBtn2) {
-        raceCounter--;
-        if (raceCounter > 99) {
-          raceCounter = 99;
-        }
-        Serial.print(raceSplits[raceCounter]);
-        delay(BUTTON_DELAY);
-      }
+  do { // wait for either btn1 or btn3 input
+    AWAIT_BUTTON(t, TASK_BTN(BTN1) | TASK_BTN(BTN3) | TASK_BTN(BTN4), TASK_FOREVER);
+  } while (t->event.type != INPUT_PRESS);
+  if (t->event.button == BTN4) TASK_EXIT(t);
+  dataRace = t->event.button == BTN3;
+  dataAt = 0;
+
+  for (;;) {
+    dataShow();
+    AWAIT_BUTTON(t, TASK_BTN(BTN1) | TASK_BTN(BTN2) | TASK_BTN(BTN4), TASK_FOREVER);
+    if (t->event.type != INPUT_PRESS && t->event.type != INPUT_REPEAT) continue;
+    if (t->event.button == BTN4) break;
+    {
+      uint8_t count = dataRace ? 100 : 10;
+      if (t->event.button == BTN1) dataAt = dataAt + 1 < count ? dataAt + 1 : 0;
+      else dataAt = dataAt ? dataAt - 1 : count - 1;
     }
+    if (dataRace) TRACE(TRACE_RACE_VIEW, dataAt, raceSplits[dataAt]);
+    else TRACE(TRACE_CHRO_VIEW, dataAt, chronoSplits[dataAt]);
   }
+  TASK_END(t);
+}
+
+// the trace goes out over USB on the way in and out, if a host has the port open
+uint8_t chronoData() {
+  TRACE_FLUSH(traceNames, TRACE_IDS);
+  Tasks.run(appTask, dataTask);
+  TRACE_FLUSH(traceNames, TRACE_IDS);
   return 0;
 }
 
@@ -537,177 +736,167 @@ uint8_t chronoData() {
 Party mode.
 Watch flashes custom messages and LEDs
 */
-uint8_t party() {
-  uint8_t cnt = 0;
-  while(readBtn3) {
-    if (cnt) {
-      delay(BUTTON_DELAY);
+bool partyOvta; // which of the two party screens is up
+
+uint8_t partyTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  partyOvta = 0;
+  for (;;) {
+    if (partyOvta) {
       TM8.dispStr("OVTA", 0);
       TM8.dispStr("TIME", 1);
     } else {
-      delay(BUTTON_DELAY);
       TM8.dispStr("it*s", 0);
       TM8.dispStr(" lit", 1);
     }
-    if (!readBtn4) {
+    AWAIT_BUTTON(t, TASK_ALL_BTNS, TASK_FOREVER);
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN3) break;
+    if (t->event.button == BTN2) {
+      partyOvta = !partyOvta;
+    } else if (t->event.button == BTN4) {
       TM8.dispStr("", 0);
       TM8.dispStr("", 1);
-      delay(5000);
+      AWAIT_SLEEP_MS(t, 5000);
       TM8.animTach();
-    }
-    if (!readBtn2) {
-      cnt = !cnt;
-    }
-    if (!readBtn1) {
-      delay(5000);
-      for (int i=0; i<5; i++) {
-        digitalWrite(leds[i], 1);
+    } else if (t->event.button == BTN1) {
+      AWAIT_SLEEP_MS(t, 5000);
+      for (int i=0; i<LED_BAR_LEN; i++) {
+        Leds.fadeTo(LED_CH_BAR + i, LED_FULL, 1000);
       }
-      delay(5000);
-      for (int i=0; i<5; i++) {
-        digitalWrite(leds[i], 0);
+      AWAIT_SLEEP_MS(t, 5000);
+      for (int i=0; i<LED_BAR_LEN; i++) {
+        Leds.fadeTo(LED_CH_BAR + i, 0, 1000);
       }
-      return 0;
+      AWAIT_SLEEP_MS(t, 1000);
+      break;
     }
   }
+  TASK_END(t);
+}
+
+uint8_t party() {
+  Tasks.run(appTask, partyTask);
   return 0;
 }
 
-void matchNumbersGame() {
-  uint8_t numbers = 0;
-  uint8_t hits = 0;
-  while (hits < 3) {
-  uint8_t target = rand() % 10;  /* generate a number from 0 - 9 */
-  uint32_t startTime = millis();
-    while(readBtn3) {
-      if (numbers > 9) {numbers = 0;}
-      if (numbers == 0) {TM8.dispStr("0000", 0);}
-      else {TM8.dispDec(numbers * 1111, 0);}
-      if (target == 0) {TM8.dispStr("0000", 1);}
-      else {TM8.dispDec(target * 1111, 1);}
-      if (millis() - startTime >= 200) {
-        numbers++;
-        startTime = millis();
+uint8_t matchHits;
+uint8_t matchNumber; // counting up on the left
+uint8_t matchTarget;
+
+// one digit on all four places
+void matchDigit(uint8_t n, bool disp) {
+  if (n == 0) TM8.dispStr("0000", disp);
+  else TM8.dispDec(n * 1111, disp);
+}
+
+/*
+the left LCD counts 0-9 every 200ms, BTN3 stops it. stop it on the number on
+the right 3 times to win
+*/
+uint8_t matchTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  matchHits = 0;
+  matchNumber = 0;
+  while (matchHits < 3) {
+    matchTarget = rand() % 10;  /* generate a number from 0 - 9 */
+    matchDigit(matchTarget, 1);
+    for (;;) {
+      matchDigit(matchNumber, 0);
+      AWAIT_BUTTON(t, TASK_BTN(BTN3), 200);
+      if (!t->gotEvent) {
+        matchNumber = matchNumber < 9 ? matchNumber + 1 : 0;
+      } else if (t->event.type == INPUT_PRESS) {
+        break;
       }
     }
-    if (numbers == target) {
-      hits++;
+    if (matchNumber == matchTarget) {
+      matchHits++;
+      blinkBoth(true);
       TM8.dispStr("HIT ", 0);
-      TM8.dispDec(hits, 1);
-      delay(1000);
-      for (int i=0; i<5; i++) {
-        TM8.dispStr("HIT ", 0);
-        TM8.dispDec(hits, 1);
-        delay(50);
-        TM8.dispStr("", 0);
-        TM8.dispStr("", 1);
-        delay(50);
-      }
+      TM8.dispDec(matchHits, 1);
+      AWAIT_SLEEP_MS(t, 1500);
     } else {
-      for (int i=0; i<5; i++) {
-        TM8.dispStr("MISS", 0);
-        TM8.dispStr("MISS", 1);
-        tone(9, 4000);
-        delay(50);
-        TM8.dispStr("", 0);
-        TM8.dispStr("", 1);
-        noTone(9);
-        delay(50);
-      }
+      blinkBoth(true);
+      TM8.dispStr("MISS", 0);
+      TM8.dispStr("MISS", 1);
+      Buzzer.play(cueError, BUZZER_PRI_UI);
+      AWAIT_SLEEP_MS(t, 1000);
     }
+    blinkBoth(false); // the next round redraws both panels
   }
+  TASK_END(t);
+}
+
+void matchNumbersGame() {
+  Tasks.run(appTask, matchTask);
 }
 
 void reactionTimingGame() {
 
 }
 
+uint8_t f1Hits;
+uint8_t f1Corner; // same numbering as the buttons, BTN1 is top left
+uint32_t f1Shown; // millis() when the target went up
+
+// lights up the 4 top or bottom segment rows of one LCD
+void f1Target(uint8_t corner) {
+  for (int i=0; i<4; i++) {
+    TM8.dispCharRaw(i, corner & 1 ? 0x1E : 0x71, corner >> 1);
+  }
+}
+
+// what's left of the 500ms to hit the target
+uint32_t f1Left() {
+  uint32_t passed = millis() - f1Shown;
+  return passed < 500 ? 500 - passed : 0;
+}
+
 /*
 F1 reaction game: hit 10 targets consecutively under 350ms reaction time to pass
+Reaction time is measured from the target going up to the button edge.
 */
-void F1ReactionGame() {
-  int timing;
-  uint8_t hits = 0;
-  uint8_t corner;
-  while (hits <= 10) {
-    delay(rand() % 2051 + 2000); // start with a random delay from 2 to 4.5 seconds
-    corner = rand() % 4;
-    switch (corner) {
-      case 0:
-        for (int i=0; i<4; i++) {
-          TM8.dispCharRaw(i, 0x71, 0);
-        }
-        break;
-      case 1:
-        for (int i=0; i<4; i++) {
-          TM8.dispCharRaw(i, 0x1E, 0);
-        }
-        break;
-      case 2:
-        for (int i=0; i<4; i++) {
-          TM8.dispCharRaw(i, 0x71, 1);
-        }
-        break;
-      case 3:
-        for (int i=0; i<4; i++) {
-          TM8.dispCharRaw(i, 0x1E, 1);
-        }
-        break;
-    }
-    bool hit = 0;
-    uint32_t startTime = millis();
-    while(millis() - startTime <= 500) {
-      if (corner == 0 && !readBtn1) {
-        hits++;
-        hit = 1;
-        TM8.dispStr("hit ", 0);
-        TM8.dispChar(3, hits, 0);
-        TM8.dispDec(millis() - startTime, 1);
-        delay(1000);
-      } else if (corner == 1 && !readBtn2) {
-        hits++;
-        hit = 1;
-        TM8.dispStr("hit ", 0);
-        TM8.dispChar(3, hits, 0);
-        TM8.dispDec(millis() - startTime, 1);
-        delay(1000);
-      } else if (corner == 2 && !readBtn3) {
-        hits++;
-        hit = 1;
-        TM8.dispStr("hit ", 0);
-        TM8.dispChar(3, hits, 0);
-        TM8.dispDec(millis() - startTime, 1);
-        delay(1000);
-      } else if (corner == 3 && !readBtn4) {
-        hits++;
-        hit = 1;
-        TM8.dispStr("hit ", 0);
-        TM8.dispChar(3, hits, 0);
-        TM8.dispDec(millis() - startTime, 1);
-        delay(1000);
-      }
-    }
-    if (!hit) {
+uint8_t f1Task(TM8_task *t) {
+  TASK_BEGIN(t);
+  f1Hits = 0;
+  while (f1Hits <= 10) {
+    AWAIT_SLEEP_MS(t, rand() % 2051 + 2000); // start with a random delay from 2 to 4.5 seconds
+    f1Corner = rand() % 4;
+    f1Target(f1Corner);
+    f1Shown = millis();
+    do {
+      AWAIT_BUTTON(t, TASK_BTN(f1Corner), f1Left());
+    } while (t->gotEvent && t->event.type != INPUT_PRESS);
+    if (t->gotEvent) {
+      f1Hits++;
+      TM8.dispStr("hit ", 0);
+      TM8.dispChar(3, f1Hits, 0);
+      TM8.dispDec(t->event.time - f1Shown, 1);
+    } else {
       TM8.dispStr("TIME", 0);
       TM8.dispStr(" OUT", 1);
-      delay(1000);
     }
-    hit = 0;
+    AWAIT_SLEEP_MS(t, 1000);
     TM8.Command(LCD_CLEAR, 0);
     TM8.Command(LCD_CLEAR, 1);
   }
+  TASK_END(t);
+}
+
+void F1ReactionGame() {
+  Tasks.run(appTask, f1Task);
+}
+
+// enterValue() renderer for the game picker
+void drawGame(uint8_t v) {
+  TM8.dispDec(v, 1);
 }
 
 void game() {
   uint8_t gameNo = 1;
-  while(readBtn3) {
-    TM8.dispStr("GAME", 0);
-    TM8.dispDec(gameNo, 1);
-    if (!readBtn1) {gameNo++;delay(BUTTON_DELAY);}
-    if (!readBtn2) {gameNo--;delay(BUTTON_DELAY);}
-    if (gameNo < 1) {gameNo = 3;}
-    if (gameNo > 3) {gameNo = 1;}
-  }
+  TM8.dispStr("GAME", 0);
+  if (!enterValue(gameNo, 1, 3, drawGame, 0)) return; // BTN4 backs out
   for (int i=3; i>0; i--) {
     TM8.animSwipeDown(30);
   }
@@ -726,30 +915,328 @@ void game() {
   }
 }
 
-void flashLight() {
-  bool flash = 0;
+bool flashBar; // status LEDs on
+bool flashLit;
+uint8_t flashLevel;
+
+// btn3 turns the flashlight on, btn2 steps it down (full, half, quarter), btn4 toggles the status LEDs, btn1 exits
+uint8_t flashTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  flashBar = 0;
+  flashLit = 0;
+  flashLevel = LED_FULL;
   TM8.dispStr("", 0);
   TM8.dispStr("", 1);
-  while(readBtn1) {
-    if (!readBtn4) {
-      flash = !flash;
-      delay(BUTTON_DELAY);
+  for (;;) {
+    AWAIT_BUTTON(t, TASK_ALL_BTNS, TASK_FOREVER);
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN1) break;
+    if (t->event.button == BTN4) {
+      flashBar = !flashBar;
+      Leds.bar(flashBar, 1, LED_DIM); // no need for full current on the status LEDs
+    } else if (t->event.button == BTN3 && !flashLit) {
+      flashLit = 1;
+      Leds.fadeTo(LED_CH_FLASH, flashLevel, 200);
+    } else if (t->event.button == BTN2) {
+      flashLevel = flashLevel > LED_DIM ? flashLevel / 2 : LED_FULL;
+      if (flashLit) Leds.set(LED_CH_FLASH, flashLevel);
     }
-    if (!readBtn3) {
-      digitalWrite(6, !readBtn3);
+  }
+  Leds.set(LED_CH_FLASH, 0);
+  Leds.bar(0, 1);
+  TASK_END(t);
+}
+
+void flashLight() {
+  Tasks.run(appTask, flashTask);
+}
+
+/*
+I2C bus statistics, kept by the Wire fork for every address on both buses. to
+see which device dominates bus time in an app: reset them here, run the app,
+come back. the LCDs' own redraws show up too.
+BTN1: next device
+BTN2: next figure, named on the right LCD for a moment. share of its bus' time
+in %, transactions, bytes, NACKs, slowest call in us
+BTN3: dump everything over USB, histograms included. held: reset the counters
+BTN4: quit
+*/
+#define BUS_FIGURES 5
+
+const char *const busFigureNames[BUS_FIGURES] = {"tIME", "CALL", "byte", "nACK", "PEAK"};
+TwoWire *const busWires[BOOT_BUSES] = {&Wire, &wire1};
+
+uint8_t busDevice; // counted across both buses, Wire's first
+uint8_t busFigure;
+
+uint8_t busDevices() {
+  return Wire.statsCount() + wire1.statsCount();
+}
+
+// the n-th device across both buses, 0 past the last one
+const TwoWireStats *busStats(uint8_t n, uint8_t &bus) {
+  for (bus=0; bus<BOOT_BUSES; bus++) {
+    if (n < busWires[bus]->statsCount()) return &busWires[bus]->statsAt(n);
+    n -= busWires[bus]->statsCount();
+  }
+  return 0;
+}
+
+// the POST's name for a known device, bus number and hex address otherwise
+void busName(char *name, uint8_t bus, uint8_t address) {
+  static const char hex[] = "0123456789abcdef";
+  for (uint8_t i=0; i<BOOT_DEVICES; i++) {
+    if (bootDevices[i].bus != bus || bootDevices[i].address != address) continue;
+    strcpy(name, bootDevices[i].name);
+    return;
+  }
+  name[0] = '0' + bus;
+  name[1] = ' ';
+  name[2] = hex[address >> 4];
+  name[3] = hex[address & 0x0F];
+  name[4] = 0;
+}
+
+uint32_t busTotalUs(uint8_t bus) {
+  uint32_t total = 0;
+  for (uint8_t i=0; i<busWires[bus]->statsCount(); i++) {
+    total += busWires[bus]->statsAt(i).busUs;
+  }
+  return total;
+}
+
+void busShow() {
+  uint8_t bus;
+  const TwoWireStats *s = busStats(busDevice, bus);
+  if (!s) {
+    TM8.dispStr("none", 0);
+    TM8.dispStr("", 1);
+    return;
+  }
+  char name[5];
+  busName(name, bus, s->address);
+  TM8.dispStr(name, 0);
+
+  uint32_t v = 0;
+  if (busFigure == 0) {
+    uint32_t total = busTotalUs(bus);
+    v = total ? (uint64_t)s->busUs * 100 / total : 0;
+  } else if (busFigure == 1) {
+    v = s->transfers;
+  } else if (busFigure == 2) {
+    v = s->bytes;
+  } else if (busFigure == 3) {
+    v = s->nacks;
+  } else {
+    v = s->maxUs;
+  }
+  TM8.dispDec(v > 9999 ? 9999 : v, 1);
+}
+
+// one CSV line per device, then the bus recoveries
+void busDump() {
+  Serial.print("bus,addr,name,calls,bytes,nacks,retries,failures,faults,bus_us,max_us");
+  for (uint8_t h=0; h<WIRE_HIST_BUCKETS; h++) {
+    Serial.print(",us");
+    Serial.print(1UL << h);
+  }
+  Serial.println();
+  for (uint8_t bus=0; bus<BOOT_BUSES; bus++) {
+    for (uint8_t i=0; i<busWires[bus]->statsCount(); i++) {
+      const TwoWireStats &s = busWires[bus]->statsAt(i);
+      char name[5];
+      busName(name, bus, s.address);
+      const uint32_t fields[] = {s.transfers, s.bytes, s.nacks, s.retries, s.failures, s.busFaults, s.busUs, s.maxUs};
+      Serial.print(bus);
+      Serial.print(",0x");
+      Serial.print(s.address, HEX);
+      Serial.print(',');
+      Serial.print(name);
+      for (uint8_t f=0; f<sizeof(fields) / sizeof(fields[0]); f++) {
+        Serial.print(',');
+        Serial.print(fields[f]);
+      }
+      for (uint8_t h=0; h<WIRE_HIST_BUCKETS; h++) {
+        Serial.print(',');
+        Serial.print(s.hist[h]);
+      }
+      Serial.println();
     }
-    // digitalWrite(6, flash);
-    for (int i=0; i<5; i++) {
-      digitalWrite(leds[i], flash);
+    Serial.print("# bus ");
+    Serial.print(bus);
+    Serial.print(" recoveries ");
+    Serial.println(busWires[bus]->recoveries());
+  }
+}
+
+uint8_t busTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  busDevice = 0;
+  busFigure = 0;
+  for (;;) {
+    busShow();
+    AWAIT_BUTTON(t, TASK_ALL_BTNS, 1000); // the figures keep moving, redraw now and then
+    if (!t->gotEvent) continue;
+    if (t->event.button == BTN3 && t->event.type == INPUT_LONG) {
+      Wire.resetStats();
+      wire1.resetStats();
+      busDevice = 0;
+      TM8.dispStr(" CLr", 1);
+      AWAIT_SLEEP_MS(t, 600);
+      continue;
+    }
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN4) TASK_EXIT(t);
+    if (t->event.button == BTN1) {
+      busDevice = busDevice + 1 < busDevices() ? busDevice + 1 : 0;
+    } else if (t->event.button == BTN2) {
+      busFigure = (busFigure + 1) % BUS_FIGURES;
+      TM8.dispStr(busFigureNames[busFigure], 1);
+      AWAIT_SLEEP_MS(t, 600);
+    } else if (t->event.button == BTN3) {
+      busDump();
     }
   }
-  digitalWrite(6, 0);
+  TASK_END(t);
+}
+
+void busStatsApp() {
+  Tasks.run(appTask, busTask);
+}
+
+/*
+I2C scanner, grown out of scratchpad/I2C_scanner_LCD.cpp.
+sweeps both buses with a single short ping per address, then pings whatever
+answered SCAN_PINGS more times to time the round trip. devices the board should
+have but didn't answer are listed too.
+left LCD: device, POST name if it's a known one. right LCD: best round trip in
+us, "----" if it never answered. it blinks for missing, flaky (missed pings)
+and slow (best round trip over SCAN_SLOW times what the bus clock needs) devices.
+pings are timed with Clock.micros(), the core's micros() is off below 48MHz.
+BTN1/BTN2: next/previous device. BTN3: scan again. BTN4: quit
+*/
+#define SCAN_FIRST 0x08 // 0x00-0x07 and 0x78-0x7F are reserved
+#define SCAN_LAST 0x77
+#define SCAN_TIMEOUT_US 300 // the address byte takes 90us at 100kHz, a bus that needs longer is stuck
+#define SCAN_PINGS 8
+#define SCAN_MAX 16
+#define SCAN_SLOW 2
+#define SCAN_PING_BITS 11 // START, address + R/W, ACK, STOP
+
+struct TM8_scanHit
+{
+  uint8_t bus;
+  uint8_t address;
+  uint8_t acks; // out of SCAN_PINGS
+  uint16_t bestUs;
+  uint16_t worstUs;
+};
+
+TM8_scanHit scanHits[SCAN_MAX];
+uint8_t scanCount;
+uint8_t scanAt;
+
+TM8_scanHit &scanAdd(uint8_t bus, uint8_t address) {
+  TM8_scanHit &h = scanHits[scanCount++];
+  h.bus = bus;
+  h.address = address;
+  h.acks = 0;
+  h.bestUs = 0xFFFF;
+  h.worstUs = 0;
+  return h;
 }
 
-void showBMEData(uint16_t dispDelay) {
-	bme.setOpMode(BME68X_FORCED_MODE);
-	delayMicroseconds(bme.getMeasDur());
-  
+bool scanFound(uint8_t bus, uint8_t address) {
+  for (uint8_t i=0; i<scanCount; i++) {
+    if (scanHits[i].bus == bus && scanHits[i].address == address) return true;
+  }
+  return false;
+}
+
+void scanSweep() {
+  scanCount = 0;
+  for (uint8_t b=0; b<BOOT_BUSES; b++) {
+    TwoWire *bus = busWires[b];
+    bus->setTimeout(SCAN_TIMEOUT_US);
+    for (uint8_t a=SCAN_FIRST; a<=SCAN_LAST && scanCount<SCAN_MAX; a++) {
+      if (bus->ping(a)) continue;
+      TM8_scanHit &h = scanAdd(b, a);
+      for (uint8_t p=0; p<SCAN_PINGS; p++) {
+        uint32_t start = Clock.micros();
+        uint8_t err = bus->ping(a);
+        uint32_t us = Clock.micros() - start;
+        if (err) continue;
+        h.acks++;
+        if (us < h.bestUs) h.bestUs = us;
+        if (us > h.worstUs) h.worstUs = us;
+      }
+    }
+    bus->setTimeout(WIRE_TIMEOUT_US);
+  }
+  for (uint8_t i=0; i<BOOT_DEVICES && scanCount<SCAN_MAX; i++) {
+    if (!scanFound(bootDevices[i].bus, bootDevices[i].address)) scanAdd(bootDevices[i].bus, bootDevices[i].address);
+  }
+}
+
+// missing, flaky or slow
+bool scanSuspect(const TM8_scanHit &h) {
+  uint32_t expectUs = SCAN_PING_BITS * 1000000UL / busWires[h.bus]->getClock();
+  return h.acks < SCAN_PINGS || h.bestUs > SCAN_SLOW * expectUs;
+}
+
+void scanShow() {
+  if (!scanCount) {
+    TM8.dispStr("None", 0);
+    TM8.dispStr("Nada", 1);
+    return;
+  }
+  const TM8_scanHit &h = scanHits[scanAt];
+  char name[5];
+  busName(name, h.bus, h.address);
+  TM8.dispStr(name, 0);
+  TM8.blink(scanSuspect(h), 1);
+  if (h.acks) TM8.dispDec(h.bestUs, 1);
+  else TM8.dispStr("----", 1);
+}
+
+uint8_t scanTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    TM8.dispStr("12c ", 0); // 1 instead of I for higher "I" character
+    TM8.dispStr("scan", 1);
+    scanSweep();
+    scanAt = 0;
+    for (uint8_t i=0; i<scanCount; i++) {
+      if (!scanSuspect(scanHits[i])) continue;
+      Buzzer.play(cueError, BUZZER_PRI_UI);
+      break;
+    }
+    for (;;) {
+      scanShow();
+      AWAIT_BUTTON(t, TASK_ALL_BTNS, TASK_FOREVER);
+      if (t->event.type != INPUT_PRESS) continue;
+      if (t->event.button == BTN4) {
+        TM8.blink(false, 1); // goes out with the menu's next draw
+        TASK_EXIT(t);
+      }
+      if (t->event.button == BTN3) break;
+      if (!scanCount) continue;
+      if (t->event.button == BTN1) {
+        scanAt = scanAt + 1 < scanCount ? scanAt + 1 : 0;
+      } else if (t->event.button == BTN2) {
+        scanAt = scanAt ? scanAt - 1 : scanCount - 1;
+      }
+    }
+  }
+  TASK_END(t);
+}
+
+void i2cScanner() {
+  Tasks.run(appTask, scanTask);
+}
+
+// once a forced conversion is done
+void showBMEData() {
 	if (bme.fetchData()) {
 		bme.getData(BMEData);
     int temp = (int)BMEData.temperature;
@@ -757,91 +1244,397 @@ void showBMEData(uint16_t dispDelay) {
 		TM8.dispDec(temp, 0);
     TM8.dispDec(hum, 1);
 	}
+}
+
+TM8_accelSample accelMean; // mean of the last FIFO batch
+bool accelFresh; // accelMean hasn't been shown yet
+
+// FIFO consumer for the accl screen
+void accelAverage(const TM8_accelSample *batch, uint8_t n) {
+  countSteps(batch, n); // keep counting while the screen is up
+  int32_t x = 0, y = 0, z = 0;
+  for (int i=0; i<n; i++) {
+    x += batch[i].x;
+    y += batch[i].y;
+    z += batch[i].z;
+  }
+  accelMean.x = x / n;
+  accelMean.y = y / n;
+  accelMean.z = z / n;
+  accelFresh = true;
+}
 
-  delay(dispDelay);
+/*
+shows the average of each FIFO batch in tenths of g.
+the LIS3DH samples into its FIFO on its own and the MCU sleeps in between batches.
+whoever drains it first, this screen or the steps task, accelAverage() sees the batch
+*/
+void showAccelData() {
+  lis.service();
+  if (!accelFresh) return;
+  accelFresh = false;
+  TM8.dispDec(accelMean.x / 100, 0);
+  TM8.dispDec(accelMean.y / 100, 1);
 }
 
-void showAccelData(uint16_t dispDelay) {
-  int xAxis = round(accel.readFloatAccelX() * 10);
-  int yAxis = round(accel.readFloatAccelY() * 10);
-  int zAxis = round(accel.readFloatAccelZ() * 10);
+uint8_t tachCylinders = 4; // 4 stroke engine, fires cylinders/2 times per revolution
+int16_t tachFrame[FFT_N];
+uint16_t tachFill;
+int16_t tachRe[FFT_N]; // FFT work space, a task's locals don't survive its AWAITs
+int16_t tachIm[FFT_N];
 
-  TM8.dispDec(xAxis, 0);
-  TM8.dispDec(yAxis, 1);
+// FIFO consumer for tach(), sums the axes so the mount orientation doesn't matter
+void tachCollect(const TM8_accelSample *batch, uint8_t n) {
+  for (int i=0; i<n && tachFill < FFT_N; i++) {
+    tachFrame[tachFill++] = batch[i].x + batch[i].y + batch[i].z;
+  }
+}
 
-  delay(dispDelay);
+// enterValue() renderer for the cylinder count
+void drawCylinders(uint8_t v) {
+  TM8.dispDec(v, 1);
 }
 
-void showTelemetry() {
-  while (readBtn4) {
+// FFT of a full frame, RPM on the left
+void tachShow() {
+  uint16_t minBin = (uint32_t)10 * FFT_N / lis.odrHz() + 1;
+  fftPrepare(tachFrame, tachRe);
+  fftReal(tachRe, tachIm);
+  uint32_t peak = fftPeak(tachRe, tachIm, minBin, FFT_N / 2 - 2);
+  uint32_t hzQ4 = peak * lis.odrHz() / (FFT_N * 16); // peak is Q8 bins, keep 4 fractional bits
+  uint32_t rpm = hzQ4 * 120 / (16 * tachCylinders);
+  TM8.dispDec(rpm, 0);
+  TM8.dispDec(tachCylinders, 1);
+}
+
+// one FIFO batch per wake, BTN4 cuts the sleep short and quits
+uint8_t tachTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    tachFill = 0;
+    while (tachFill < FFT_N) {
+      AWAIT_BUTTON(t, TASK_BTN(BTN4), lis.batchPeriod());
+      if (t->gotEvent && t->event.type == INPUT_PRESS) TASK_EXIT(t);
+      lis.service();
+    }
+    tachShow();
+  }
+  TASK_END(t);
+}
+
+/*
+Tachometer. Strap the watch to something bolted to the engine.
+LIS3DH runs at 1344Hz into the FIFO, every 256 samples go through the FFT and the
+strongest vibration between 10Hz and the Nyquist limit is taken as the firing frequency.
+RPM = f * 120 / cylinders. 5.25Hz bins, refined by interpolation.
+BTN1/BTN2: cylinder count, BTN3: start, BTN4: quit
+*/
+void tach() {
+  TM8.dispStr("cyl ", 0);
+  if (!enterValue(tachCylinders, 1, 12, drawCylinders, 0)) return; // BTN4 backs out
+
+  wire1.setClock(400000); // 1344Hz * 6 bytes doesn't fit through 100kHz
+  lis.begin(ACCEL_ODR_1344, 4, ACCEL_MODE_NORM);
+  lis.fifoBegin(16, tachCollect); // 12ms batches, FIFO overflows at 24ms
+  Tasks.run(appTask, tachTask);
+  accelDefault();
+  wire1.setClock(100000);
+}
+
+/*
+today's steps on the left (in thousands past 9999), active minutes on the right
+*/
+void showSteps() {
+  lis.service();
+  stepsTick();
+  if (pedometer.steps > 9999) {
+    char str[5];
+    sprintf(str, "%3luk", pedometer.steps / 1000);
+    TM8.dispStr(str, 0);
+  } else {
+    TM8.dispDec(pedometer.steps, 0);
+  }
+  TM8.dispDec(pedometer.activeMinutes, 1);
+}
+
+/*
+deep sleeps for ms (0 for until a button or gesture), waking once per FIFO batch
+to run the step counter. millis() is stopped in STANDBY, so ms is counted down by hand.
+a button edge wakes it to sit out the debounce in IDLE, poll() then runs the press hook
+*/
+void sleepCountingSteps(uint32_t ms) {
+  uint32_t batch = lis.batchPeriod();
+  bool forever = !ms;
+  Clock.set(CLOCK_1MHZ); // draining the FIFO and counting steps doesn't need more
+  while ((forever || ms) && !Events.pending() && !Timers.fired) {
+    uint32_t chunk = forever || ms > batch ? batch : ms;
+    uint32_t due = Input.nextDeadline(); // a press being debounced, its hook queues the event
+    if (due < chunk) chunk = due ? due : 1;
+    Power.release(PWR_SERCOM2); // both buses are off while asleep unless an app still holds them
+    Power.release(PWR_SERCOM3);
+    uint32_t slept = Sleep.nap(chunk, true);
+    Power.acquire(PWR_SERCOM2);
+    Power.acquire(PWR_SERCOM3);
+    if (!forever) ms -= slept < ms ? slept : ms;
+    Input.resync(); // before poll(), millis() stood still if that was STANDBY
+    Input.poll();
+    lis.service();
+    stepsTick();
+  }
+  lis.service();
+  stepsTick();
+  Clock.set(CLOCK_8MHZ); // back to UI speed for whatever woke us
+  Input.resync();
+}
+
+// true once the screen's BTN4 was pressed
+bool telemetryBack(TM8_task *t) {
+  return t->gotEvent && t->event.type == INPUT_PRESS;
+}
+
+/*
+sensor readouts. btn1: temp/humidity, btn3: accelerometer, btn2: steps/active minutes
+btn4 goes back from a readout, and quits from the choice
+*/
+uint8_t telemetryTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  for (;;) {
     TM8.dispStr("temp", 0);
     TM8.dispStr("accl", 1);
-    if (!readBtn1) {
-      while (readBtn4) {
-        showBMEData(1000);
-      }
-    } else if (!readBtn3) {
-      while (readBtn4) {
-        showAccelData(100);
-      }
+    AWAIT_BUTTON(t, TASK_ALL_BTNS, TASK_FOREVER);
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN4) break;
+
+    if (t->event.button == BTN1) {
+      do { // a forced conversion every second
+        bme.setOpMode(BME68X_FORCED_MODE);
+        AWAIT_SLEEP_MS(t, bme.getMeasDur() / 1000 + 1); // conversion + heater
+        showBMEData();
+        AWAIT_BUTTON(t, TASK_BTN(BTN4), 1000);
+      } while (!telemetryBack(t));
+    } else if (t->event.button == BTN3) {
+      accelFresh = false;
+      lis.fifoBegin(25, accelAverage); // 25 samples at 50Hz, two wakes per second
+      do {
+        showAccelData();
+        AWAIT_BUTTON(t, TASK_BTN(BTN4), lis.batchPeriod());
+      } while (!telemetryBack(t));
+      lis.fifoBegin(30, countSteps); // back to the pedometer
+    } else if (t->event.button == BTN2) {
+      do {
+        showSteps();
+        AWAIT_BUTTON(t, TASK_BTN(BTN4), lis.batchPeriod());
+      } while (!telemetryBack(t));
     }
   }
+  TASK_END(t);
 }
 
-uint8_t configure() {
-  detachInterrupt(btn3);
-  while(readBtn4) {
+void showTelemetry() {
+  Tasks.run(appTask, telemetryTask);
+}
+
+/*
+settings kept in the EEPROM (0x50 on wire1). without one the defaults are used
+and changes only last until the next reset
+*/
+#define ROM_POMO 0x0000 // TM8_pomoConfig
+#define ROM_DEVICES 0x0010 // TM8_bootCache
+
+#define BOOT_STEPS 5 // setup() stages shown on the LED bar
+#define BOOT_FADE_MS 300
+
+bool romPresent = false;
+
+void loadSettings() {
+  if (romPresent) rom.get(ROM_POMO, TM8.pomo);
+  if (!pomoValid(TM8.pomo)) TM8.pomo = pomoDefaults;
+}
+
+void saveSettings() {
+  if (romPresent) rom.put(ROM_POMO, TM8.pomo);
+}
+
+void saveDeviceMap(uint8_t devices) {
+  TM8_bootCache cache = {BOOT_CACHE_MAGIC, devices};
+  if (romPresent) rom.put(ROM_DEVICES, cache);
+}
+
+/*
+compares what Boot.probe() found with the map from the last boot, the whole
+board when there's none. missing devices are shown until the full POST
+saves a new map, new ones are just added to it. the first map is saved
+straight away so a missing device is only shown once. the map lives in
+the EEPROM, so without one the EEPROM itself isn't expected
+*/
+void checkDeviceMap() {
+  TM8_bootCache cache = {0, 0};
+  if (romPresent) rom.get(ROM_DEVICES, cache);
+  bool mapped = cache.magic == BOOT_CACHE_MAGIC;
+  uint8_t expected = mapped ? cache.devices : BOOT_DEV_ALL & ~(romPresent ? 0 : BOOT_DEV_ROM);
+  uint8_t missing = expected & ~Boot.found;
+
+  if (missing) Buzzer.play(cueError, BUZZER_PRI_ALARM);
+  for (uint8_t i=0; i<BOOT_DEVICES; i++) {
+    if (!(missing & (1 << i))) continue;
+    blinkBoth(true);
+    TM8.dispStr(bootDevices[i].name, 0);
+    TM8.dispStr("GONE", 1);
+    Sleep.delay(1500);
+    blinkBoth(false);
+  }
+  if (!mapped) saveDeviceMap(Boot.found);
+  else if (Boot.found & ~expected) saveDeviceMap(expected | Boot.found);
+}
+
+// boot progress on the LED bar, drawn by the PWM interrupt so setup() doesn't wait on it
+void bootStep(uint8_t step) {
+  Leds.bar(step, BOOT_STEPS, LED_DIM);
+}
+
+void drawEntryStudy(uint8_t v) {
+  TM8.dispDec(v, 0);
+  TM8.dispStr("STUD", 1);
+}
+
+void drawEntryRest(uint8_t v) {
+  TM8.dispDec(v, 0);
+  TM8.dispStr("rest", 1);
+}
+
+void configurePomo(bool study) {
+  uint8_t &mins = study ? TM8.pomo.studyMins : TM8.pomo.restMins;
+  uint8_t value = mins;
+  if (enterValue(value, 1, POMO_MAX_MINS, study ? drawEntryStudy : drawEntryRest, 0) && value != mins) {
+    mins = value;
+    saveSettings();
+  }
+}
+
+/*
+btn3: AOD/wake to check, btn1: pomodoro study minutes, btn2: rest minutes, btn4: quit.
+BTN4 also cancels a minutes entry, only its press counts so its release doesn't
+leave configure too
+*/
+uint8_t configureTask(TM8_task *t) {
+  TASK_BEGIN(t);
+  for (;;) {
     dispMode ? TM8.dispStr("aod ", 0) : TM8.dispStr("wake", 0);
-    if (!readBtn3) {
-      dispMode = !dispMode;
-      delay(BUTTON_DELAY);
-    }
+    TM8.dispStr("POMO", 1);
+    AWAIT_BUTTON(t, TASK_ALL_BTNS, TASK_FOREVER);
+    if (t->event.type != INPUT_PRESS) continue;
+    if (t->event.button == BTN4) break;
+    if (t->event.button == BTN3) dispMode = !dispMode;
+    else configurePomo(t->event.button == BTN1);
   }
-  attachInterrupt(btn3, menuInt, FALLING);
+  TASK_END(t);
+}
+
+uint8_t configure() {
+  Input.onPress(BTN3, 0);
+  Tasks.run(appTask, configureTask);
+  Input.onPress(BTN3, menuInt);
   return 0;
 }
 
+/*
+Main menu apps, in menu order.
+first entry is "quit", gets called when mainMenu() quits from no activity. Returns to main() loop.
+To add an app, write its function above and give it a line here, nothing else has to change.
+*/
+constexpr TM8_app apps[] = {
+  TM8_APP_NONE("quit"),
+#if APP_CHRO
+  TM8_APP("Chro", chronoGraph, 0, APP_REFRESH_FAST),
+#endif
+#if APP_DATA
+  TM8_APP("data", chronoData, APP_USES_USB, 250),
+#endif
+#if APP_ADJU
+  TM8_APP("Adju", setTime, 0, 250),
+#endif
+#if APP_PRTY
+  TM8_APP("prty", party, APP_USES_LEDS, 100),
+#endif
+#if APP_SENS
+  TM8_APP("sens", showTelemetry, APP_USES_BME | APP_USES_ACCEL, 500),
+#endif
+#if APP_RACE
+  TM8_APP("Race", raceChrono, APP_USES_ACCEL, APP_REFRESH_FAST),
+#endif
+#if APP_FLSH
+  TM8_APP("Flsh", flashLight, APP_USES_LIGHT, 250),
+#endif
+#if APP_GAME
+  TM8_APP("game", game, APP_USES_LEDS | APP_USES_PIEZO, APP_REFRESH_FAST),
+#endif
+#if APP_TACH
+  TM8_APP("tach", tach, APP_USES_ACCEL | APP_USES_CPU, 250),
+#endif
+#if APP_BUS
+  TM8_APP("bus ", busStatsApp, APP_USES_USB, 1000),
+#endif
+#if APP_SCAN
+  TM8_APP("12c ", i2cScanner, APP_USES_CPU, APP_REFRESH_FAST), // 48MHz, so a ping's time is the bus' and not the polling's
+#endif
+};
+
+constexpr uint8_t numApps = sizeof(apps) / sizeof(apps[0]);
+
 /*
 Main menu function.
 holds a number of "main programs" that can be quickly accessed in the main menu.
-BTN3 scrolls through list of programs, hold button to scroll quickly
-BTN4 runs selected program
+BTN1/BTN2 scroll through list of programs, hold button to scroll quickly
+BTN3 runs selected program
 After approx. 2 seconds of inactivity, mainMenu() returns 0 and goes back to home screen.
 */
 uint8_t mainMenu() {
   uint8_t mainProgramNumber = 1; // counter variable for scrolling through list of programs in main menu
-  uint32_t startTime = millis(); // time when function starts
-  while (millis() - startTime <= INACTIVITY_TIMEOUT) { // while under timeout threshold
+  TM8_inputEvent e;
+  Input.flush(); // drop the press that opened the menu
+  for (;;) {
     TM8.dispDec(mainProgramNumber, 0); // display program number on the left, but it starts from 1, not 0
-    TM8.dispStr(mainPrograms[mainProgramNumber], 1); // display program name on the right
-    if (!readBtn1) { // if button 1 is pressed
+    TM8.dispText(apps[mainProgramNumber].name, 1); // display program name on the right
+    if (!Input.wait(e, INACTIVITY_TIMEOUT)) { // sleeps until a button or the timeout, any event extends it
+      return 0;
+    }
+    if (e.type != INPUT_PRESS && e.type != INPUT_REPEAT) { // held buttons auto-repeat
+      continue;
+    }
+    if (e.button == BTN1) { // if button 1 is pressed
       mainProgramNumber++; // increment main program counter and select next program
-      if (mainProgramNumber >= numPrograms) { // roll back to program 0 after going through entire list
+      if (mainProgramNumber >= numApps) { // roll back to program 0 after going through entire list
         mainProgramNumber = 1;
       }
-      delay(BUTTON_DELAY); // short delay to prevent crazy fast scrolling
-      startTime = millis(); // reset timer to 0 to extend time
-    } else if (!readBtn2) { // if button 2 is pressed
+    } else if (e.button == BTN2) { // if button 2 is pressed
       mainProgramNumber--; // increment main program counter and select next program
-      if (mainProgramNumber >= numPrograms) { // roll back to program 0 after going through entire list
-        mainProgramNumber = numPrograms - 1;
+      if (mainProgramNumber >= numApps) { // roll back to program 0 after going through entire list
+        mainProgramNumber = numApps - 1;
       }
-      delay(BUTTON_DELAY); // short delay to prevent crazy fast scrolling
-      startTime = millis(); // reset timer to 0 to extend time
-    } else if (!readBtn3) { // if button 3 is pressed
-      for (int i=0; i<3; i++) { // blink selected program 3 times on the display
-        TM8.dispStr("", 0);
-        TM8.dispStr("", 1);
-        delay(50);
-        TM8.dispDec(mainProgramNumber, 0);
-        TM8.dispStr(mainPrograms[mainProgramNumber], 1);
-        delay(50);
-      }
-      delay(500); // half-second delay
+    } else if (e.button == BTN3 && e.type == INPUT_PRESS) { // if button 3 is pressed
+      blinkBoth(true); // blink selected program on the display
+      TM8.dispDec(mainProgramNumber, 0);
+      TM8.dispText(apps[mainProgramNumber].name, 1);
+      Sleep.delay(1000);
+      blinkBoth(false); // the app's first draw stops it
       return mainProgramNumber; // end mainMenu()
     }
   }
-  return 0; // end mainMenu()
+}
+
+// holds or lets go of whatever the app table says an app needs
+void appPower(uint16_t uses, bool on) {
+  static const uint16_t resources[][2] = {
+    {APP_USES_ACCEL, PWR_ACCEL},
+    {APP_USES_BME, PWR_BME},
+    {APP_USES_FUEL, PWR_FUEL},
+    {APP_USES_USB, PWR_USB},
+  };
+  for (uint8_t i=0; i<sizeof(resources) / sizeof(resources[0]); i++) {
+    if (!(uses & resources[i][0])) continue;
+    if (on) Power.acquire(resources[i][1]);
+    else Power.release(resources[i][1]);
+  }
 }
 
 /*
@@ -849,40 +1642,17 @@ gets program number from mainMenu() and runs it
 typically you would call runMainProgram(mainMenu()) because
 the value returned from mainMenu() goes where the prog argument is
 */
-
-//char mainPrograms[9][5] = {"quit", "Chro", "data", "Adju", "accl", "temp", "Race", "Flsh", "prty"};
 void runMainProgram(uint8_t prog) {
-  switch (prog) {
-  case 0:
-    break;
-  case 1:
-    chronoGraph();
-    break;
-  case 2:
-    chronoData();
-    break;
-  case 3:
-    setTime();
-    break;
-  case 4:
-    party();
-    break;
-  case 5: 
-    showTelemetry();
-    break;
-  case 6:
-    raceChrono();
-    break;
-  case 7:
-    flashLight();
-    break;
-  case 8:
-    game();
-    break;
-  default:
+  if (prog >= numApps) {
     TM8.dispStr("Fuck", 0);
     delay(1000);
-    break;
+  } else if (apps[prog].entry) {
+    uint8_t profile = Clock.profile();
+    Clock.set(apps[prog].uses & (APP_USES_CPU | APP_USES_USB) ? CLOCK_48MHZ : CLOCK_8MHZ);
+    appPower(apps[prog].uses, true);
+    apps[prog].entry();
+    appPower(apps[prog].uses, false);
+    Clock.set(profile);
   }
   TM8.scrambleAnim(8, 30);
 }
@@ -894,9 +1664,8 @@ uint8_t starter() {
     TM8.animSwipeDown(30);
   }
 
-  uint8_t battLvl = (uint8_t) fuel.cellPercent();
-  if (battLvl > 99) battLvl = 99;
-  if (battLvl <= 10 && battLvl >= 0) {
+  uint8_t battLvl = battery.percent();
+  if (battLvl <= 10) {
     for (int i=0; i<3; i++) {
       TM8.dispStr(" NO ", 0);
       TM8.dispStr("FUEL", 1);
@@ -914,7 +1683,8 @@ uint8_t starter() {
       firingAnimCount = 0;
       while(!readBtn3 && !readBtn1) {
         cnt++;
-        tone(9, cnt * 20 + 500);
+        Buzzer.tone(cnt * 20 + 500);
+        Leds.bar(cnt, 320, LED_DIM); // rev counter on the status LEDs
         uint8_t graph = cnt / 40;
         switch (graph) {
           case 0:
@@ -959,21 +1729,22 @@ uint8_t starter() {
           for (int i=0; i<5; i++) {
             TM8.dispStr("ERIC", 0);
             TM8.dispStr(" MIN", 1);
-            tone(9, 4000);
+            Buzzer.tone(4000, 60);
             delay(60);
             TM8.dispStr("", 0);
             TM8.dispStr("", 1);
-            noTone(9);
             delay(60);
           }
-          noTone(9);
+          Buzzer.stop();
+          Leds.bar(0, 320);
           return 0;
         }
       }
     } else if (readBtn3 || readBtn1) {
       while(cnt > 0) {
         cnt--;
-        tone(9, cnt * 20 + 500);
+        Buzzer.tone(cnt * 20 + 500);
+        Leds.bar(cnt, 320, LED_DIM); // rev counter on the status LEDs
         uint8_t graph = cnt / 50;
         switch (graph) {
           case 0:
@@ -1014,7 +1785,7 @@ uint8_t starter() {
             break;
         }
         if (cnt <= 0) {
-          noTone(9);
+          Buzzer.stop();
         }
       }
     }
@@ -1073,136 +1844,156 @@ float altitude(const int32_t press, const float seaLevel) {
   return (Altitude);
 }  // of method altitude()
 
+// shows time and battery for 2 seconds
+void showTimeBriefly() {
+  uint32_t timeWhenTriggered = millis();
+  battery.update(rtc.getEpoch());
+  uint8_t battLvl = battery.percent();
+  while (millis() - timeWhenTriggered <= 2000) {
+    // LCD displays hours and minutes on the left, seconds on the right
+    TM8.dispDec(rtc.getHours() * 100 + rtc.getMinutes(), 0);
+    TM8.dispDec(rtc.getSeconds() * 100 + battLvl, 1);
+    Sleep.wakeIn(100); // often enough to catch the seconds rolling over
+    Sleep.until();
+  }
+}
+
 void wakeToCheck() { 
+  TM8_event e;
   while (1) { // loop forever, "home screen" if you will
+    if (Timers.fired) Timers.service();
+    if (!Events.next(e)) e.type = 0; // woken by something that isn't queued, a timer
     // if menuInt() ISR is called, show time, and if pressed again(double click), enter menu.
     // goes back to sleep after 2 seconds
-    if (menuActive) {
-      while(!readBtn3);
-      for (int i=0; i<8; i++) {
-        uint32_t startTime = millis();
-        TM8.dispDec(random() % 9000 + 1000, 0);
-        TM8.dispDec(random() % 9000 + 1000, 1);
-        if (!readBtn3 && millis() - startTime <= 200) {
-          runMainProgram(mainMenu());
-          attachInterrupt(btn3, menuInt, FALLING); // reattach interrupt to resume normal button function in main()
-          attachInterrupt(btn1, showDateInt, FALLING);
-          menuActive = false; // reset menuActive to false
-          showDateActive = false;
+    if (e.type == EVENT_BUTTON && e.arg == BTN3) {
+      // double click opens the menu, a single click just shows the time
+      TM8_inputEvent e;
+      bool doubleClick = false;
+      TM8.scrambleAnim(1, 0);
+      while (Input.wait(e, Input.timing.doubleMs + Input.timing.debounceMs)) {
+        if (e.button == BTN3 && e.type == INPUT_DOUBLE) {
+          doubleClick = true;
+          break;
         }
-        delay(50);
       }
-      if (menuActive) {
-        uint32_t timeWhenTriggered = millis();
-        while (millis() - timeWhenTriggered <= 2000) {
-          uint8_t battLvl = (uint8_t) fuel.cellPercent();
-          if (battLvl > 99) battLvl = 99;
-
-          // LCD displays hours and minutes on the left, seconds on the right
-          TM8.dispDec(rtc.getHours() * 100 + rtc.getMinutes(), 0);
-          TM8.dispDec(rtc.getSeconds() * 100 + battLvl, 1);
-        }
+      if (doubleClick) {
+        runMainProgram(mainMenu());
+        Input.onPress(BTN3, menuInt); // restore normal button function in main()
+        Input.onPress(BTN1, showDateInt);
+      } else {
+        showTimeBriefly();
       }
-      menuActive = false;
-    } else if (showDateActive) {
+      Events.flush(); // the double click's own presses, and whatever the app had
+    } else if (e.type == EVENT_GESTURE) { // wrist raise or double tap, straight to the time
+      lis.gestureSource(); // releases INT2 for the next gesture
+      showTimeBriefly();
+    } else if (e.type == EVENT_BUTTON && e.arg == BTN1) {
       TM8.scrambleAnim(8, 30);
       TM8.dispDec(rtc.getMonth() * 100 + rtc.getDay(), 0);
       TM8.dispStr(daysOfTheWeek[getDayOfWeek(rtc.getYear() + 2000, rtc.getMonth(), rtc.getDay())], 1);
-      delay(1000);
-      showDateActive = false;
+      Sleep.delay(1000);
     }
     TM8.scrambleAnim(8, 30);
     TM8.dispStr("ovta", 0);
     TM8.dispStr("time", 1);
-    USBDevice.detach();
-    LowPower.deepSleep();
+    sleepCountingSteps(0);
   }
 }
 
 /*
 - "home screen", a big forever loop
-- Checks for ISR flags, then displays time and battery
-- ISR flags need to be set back to false after getting called to prevent them
-from being triggered by button presses within an app
+- Takes one event off the ISR ring per pass, then displays time and battery
+- Whatever queued up while a screen or an app had the buttons was meant for it,
+so the ring is flushed when one returns
 */
 void alwaysOnDisplay() {
+  TM8_event e;
   for(;;) { // loop forever
-    //if menuInt() ISR is called, pull up menu and run chosen main program 
-    if (menuActive) {
+    if (Timers.fired) Timers.service(); // RTC alarm, countdowns and alarms due
+    if (!Events.next(e)) e.type = 0; // nothing queued, the minute redraw or a timer woke us
+
+    //if the menu button was pressed, pull up menu and run chosen main program 
+    if (e.type == EVENT_BUTTON && e.arg == BTN3) {
       TM8.scrambleAnim(8, 30);
       runMainProgram(mainMenu());
-      menuActive = false;
-      showDateActive = false;
-      btn2IntActive = false;
-      btn4IntActive = false;
-    } else if (showDateActive) {
+      Events.flush();
+    } else if (e.type == EVENT_BUTTON && e.arg == BTN1) {
       TM8.scrambleAnim(8, 30);
-      uint32_t startTime = millis();
-      while (millis() - startTime <= 1000) {
-        TM8.dispDec(rtc.getMonth() * 100 + rtc.getDay(), 0);
-        TM8.dispStr(daysOfTheWeek[getDayOfWeek(rtc.getYear() + 2000, rtc.getMonth(), rtc.getDay())], 1);
-        if (!readBtn1 && millis() - startTime <= 200) {
+      TM8.dispDec(rtc.getMonth() * 100 + rtc.getDay(), 0);
+      TM8.dispStr(daysOfTheWeek[getDayOfWeek(rtc.getYear() + 2000, rtc.getMonth(), rtc.getDay())], 1);
+      TM8_inputEvent ie;
+      while (Input.wait(ie, 1000)) { // the date for a second, keep BTN1 held to set it
+        if (ie.button == BTN1 && ie.type == INPUT_LONG) {
           setDate();
-          menuActive = false;
-          showDateActive = false;
-          btn2IntActive = false;
-          btn4IntActive = false;
+          break;
         }
       }
       TM8.scrambleAnim(8, 30);
-      showDateActive = false;
-    } else if (btn2IntActive) {
-      while(!digitalRead(btn1));
+      Events.flush(); // the presses that went into setDate()
+    } else if (e.type == EVENT_BUTTON && e.arg == BTN2) {
       TM8.scrambleAnim(8, 30);
-      TM8.HIDutils(btn2);
-      menuActive = false;
-      showDateActive = false;
-      btn2IntActive = false;
-      btn4IntActive = false;
+      Power.acquire(PWR_USB);
+      TM8.HIDutils(BTN2);
+      Power.release(PWR_USB);
+      Events.flush(); // HIDutils' own buttons
       TM8.scrambleAnim(8, 30);
     }
-    // else if (btn4IntActive) {
-    //   TM8.scrambleAnim(8, 30);
-    //   TM8.pomodoro();
-    //   TM8.scrambleAnim(8, 30);
-    //   menuActive = false; // set ISR flags false, idk why but showDate and mainMenu is called after HIDutil without these
-    //   showDateActive = false;
-    //   btn2IntActive = false;
-    //   btn4IntActive = false;
-    // }
-
-    uint8_t battLvl = (uint8_t)fuel.cellPercent();
-    if (battLvl > 99) battLvl = 99;
+    else if (e.type == EVENT_BUTTON && e.arg == BTN4) { // start or stop a pomodoro, it runs in the background from there
+      TM8.scrambleAnim(8, 30);
+      TM8.pomodoro();
+      TM8.scrambleAnim(8, 30);
+      Events.flush(); // the confirm screen's buttons
+    } else if (e.type == EVENT_GESTURE) { // AOD is already showing the time, just release INT2
+      lis.gestureSource();
+    }
+
+    if (TM8.pomoActive()) { // countdown instead of the clock, the pomodoro's 1s timer wakes us to redraw
+      TM8.pomoShow();
+      sleepCountingSteps(0);
+      continue;
+    }
+
+    battery.update(rtc.getEpoch()); // only hits I2C on ALRT or every BATT_REFRESH_SECS
+    uint8_t battLvl = battery.percent();
     // LCD displays hours and minutes on the left, seconds on the right
     TM8.dispDec(rtc.getHours() * 100 + rtc.getMinutes(), 0);
     //TM8.dispDec(rtc.getSeconds() * 100 + battLvl, 1);
+    Power.acquire(PWR_BME);
     bme.setOpMode(BME68X_FORCED_MODE);
+    Sleep.delay(bme.getMeasDur() / 1000 + 1); // let the conversion finish, releasing PWR_BME aborts it
     if (bme.fetchData()) {
       bme.getData(BMEData);
       temp = (int)BMEData.temperature;
     } else {temp = 0;}
+    Power.release(PWR_BME);
     TM8.dispDec(temp * 100 + battLvl, 1); 
-    USBDevice.detach();
-    LowPower.deepSleep(59900);
+    sleepCountingSteps(59900);
   }
 }
 
 /*
 system initialization.
 initializes all peripherals and confirms on LCD display after each peripheral set-up.
-Order: rtc, LCD, I2C & SERCOM2, MAX17048, LIS3DH, BME680, I/O mode &direction, disable unnecessary peripherals
-Finally, starts starter() and after that, runs second I2C echo check
+Order: rtc, LCD, I2C & SERCOM2, device probe, MAX17048, LIS3DH, BME680, I/O mode &direction, disable unnecessary peripherals
+Progress goes on the LED bar, the LCDs only get a message when something is wrong.
 
-Hold btn4 during boot to skip starter() and second I2C check, to save battery
+Hold btn4 during boot for starter() and the second I2C check, and to save the devices found as the expected map
 */
 void setup() {
   rtc.begin(); // fire up RTC
+  Sleep.begin(); // TC3 ms sleeps, runs off the RTC's 32k generator
+  Clock.begin(); // boots at 48MHz, drops to 8MHz once setup is done
+  Buzzer.begin(9); // piezo, TCC1 for pitch and TC4 for note lengths
+  Leds.begin(ledPins, sizeof(ledPins)); // LEDs, flashlight and backlight, all off
 
   // set RTC time
   rtc.setHours(hours);
   rtc.setMinutes(minutes);
   rtc.setSeconds(seconds);
   rtc.setDate(day, month, year);
+  stepMinute = minutes;
+  stepDay = day;
+  Timers.begin(&rtc); // alarm deadlines are RTC epochs, so after the clock is set
 
   // initialize LCDs
   TM8.init_lcd();
@@ -1210,46 +2001,38 @@ void setup() {
   // start both I2C buses
   Wire.begin();
   wire1.begin();
+  Power.begin(&wire1, &Wire); // both buses stay held while the watch is awake
 
   // pinPeripheral(4, PIO_SERCOM); // SDA: D4 / PA08
   // pinPeripheral(3, PIO_SERCOM); // SCL: D3 / PA09
 
-  TM8.dispStr("0nrg", 0);
-
-  TM8.dispStr("I2C", 0); // confirm I2C initialization
-  delay(50);
+  TM8.dispStr("boot", 0);
+  Boot.probe(); // every device on both buses at once, before the libraries start talking to them
+  bootStep(1);
 
-  // start MAX17048 fuel gauge
-  if (!fuel.begin()) {
+  // start MAX17048 fuel gauge. one that isn't there is reported with the device map below
+  if (!fuel.begin() && (Boot.found & BOOT_DEV_FUEL)) {
     TM8.dispStr(" FF ", 0); // Fuel Fail error on LCD
-    for (int i=0; i<3; i++) {
-      tone(9, 4000);
-      delay(100);
-      noTone(9);
-      delay(100);
-    }
-    delay(2000);
+    Buzzer.play(cueError, BUZZER_PRI_ALARM);
+    delay(2600);
   }
-  TM8.dispStr("FUEL", 0); // confirms fuel sensor init
-  delay(50);
+  battery.begin(&fuel, &Wire, fuelAlrt);
+  bootStep(2);
 
   // start LIS3DH accelerometer
-  if (accel.begin() != IMU_SUCCESS) {
+  if (accel.begin() != IMU_SUCCESS && (Boot.found & BOOT_DEV_ACCEL)) {
     TM8.dispStr("ACCL", 0); // fail message on LCD
     TM8.dispStr("FAIL", 1);
-    for (int i=0; i<3; i++) {
-      tone(9, 4000);
-      delay(100);
-      noTone(9);
-      delay(100);
-    }
-    delay(2000);
+    Buzzer.play(cueError, BUZZER_PRI_ALARM);
+    delay(2600);
   }
-  TM8.dispStr("ACCL", 0); // confirms accelerometer init
-  TM8.dispStr("INIT", 1);
-  delay(50);
+  accelDefault(); // 50Hz low power, raise and double tap on INT2, pedometer batches
+  pedometer.begin(lis.odrHz());
+  bootStep(3);
 
-  // rom.begin(0x50, wire1);
+  romPresent = (Boot.found & BOOT_DEV_ROM) && rom.begin(ROM_ADDRESS, wire1);
+  loadSettings();
+  checkDeviceMap();
 
   // start BME680 enviro sensor
   bme.begin(BME_ADDRESS, wire1);
@@ -1258,33 +2041,19 @@ void setup() {
 	/* Set the heater configuration to 300 deg C for 100ms for Forced mode */
 	bme.setHeaterProf(300, 100);
 
-  if (bme.checkStatus() != BME68X_OK) {
+  if (bme.checkStatus() != BME68X_OK && (Boot.found & BOOT_DEV_BME)) {
     TM8.dispStr("BME ", 0); // fail message on LCD
     TM8.dispStr("FAIl", 1);
-    for (int i=0; i<3; i++) {
-      tone(9, 4000);
-      delay(100);
-      noTone(9);
-      delay(100);
-    }
-    delay(2000);
+    Buzzer.play(cueError, BUZZER_PRI_ALARM);
+    delay(2600);
   }
-  TM8.dispStr("BME ", 0); // confirms BME init
-  TM8.dispStr("INIT", 1);
-  delay(50);
+  bootStep(4);
 
   // enable pullups on all inputs to prevent floating
   pinMode(btn1, INPUT_PULLUP); // button 1, top left
   pinMode(btn2, INPUT_PULLUP); // button 2, bottom left
   pinMode(btn3, INPUT_PULLUP); // button 3, top right
 
-  pinMode(6, OUTPUT); // flashlight
-  pinMode(9, OUTPUT); // piezo
-
-  for (int i=0; i<5; i++) { // set LEDs to output
-    pinMode(leds[i], OUTPUT);
-  }
-
   // enable pullups for PA12, sets it to input, writes HIGH to it
   // this is the only way to configure PA12 without having it freeze TM8
   PORT->Group[0].PINCFG[12].reg = PORT_PINCFG_PULLEN | PORT_PINCFG_INEN;
@@ -1296,11 +2065,17 @@ void setup() {
   // set button 3 (top right) to open main menu
   // set to FALLING because RISING would often trigger the interrupt but not actually run the ISR,
   // leading to systemw-wide clock delays
-  LowPower.attachInterruptWakeup(btn1, showDateInt, FALLING);
-  //LowPower.attachInterruptWakeup(btn2, btn2Int, FALLING); // BTN2 is the "action buttton", programmable
-  attachInterrupt(btn2, btn2Int, FALLING); // for some reason, LowPower.attachInterruptWakeup does not work!!! No idea why!!!
-  attachInterrupt(btn4, btn4Int, FALLING);
-  LowPower.attachInterruptWakeup(btn3, menuInt, FALLING);
+  // Input owns the EIC lines of all four buttons (both edges, STANDBY wakeup, glitch filter)
+  // and calls these on the raw press edge. BTN2 is the "action buttton", programmable
+  Events.begin(); // before any of the ISRs below can push
+  Input.begin(buttons);
+  Input.onPress(BTN1, showDateInt);
+  Input.onPress(BTN2, btn2Int);
+  Input.onPress(BTN3, menuInt);
+  Input.onPress(BTN4, btn4Int);
+  LowPower.attachInterruptWakeup(fuelAlrt, fuelAlertInt, FALLING); // wake to redraw when SoC changes
+  pinMode(accelInt, INPUT);
+  LowPower.attachInterruptWakeup(accelInt, gestureInt, RISING);
 
   // disable all unnecessary peripherals
   SERCOM0->USART.CTRLA.bit.ENABLE=0;
@@ -1324,30 +2099,42 @@ void setup() {
   DAC->CTRLA.bit.ENABLE=0;
   AC->CTRLA.bit.ENABLE=0;
 
-  // confirm IO direction init
-  TM8.dispStr("IO d", 0);
-  TM8.dispStr(" set", 1);
-  delay(50);
+  // everything below is off unless something holds it. the pedometer and wake
+  // gestures always hold the LIS3DH, apps take the rest through the app table
+  Power.attach(PWR_ACCEL, accelDefault, accelOff);
+  Power.attach(PWR_BME, 0, bmeOff);
+  Power.attach(PWR_FUEL, fuelOn, fuelOff);
+  Power.attach(PWR_USB, usbOn, usbOff);
+  Power.acquire(PWR_ACCEL);
+  Power.settle();
+
+  Tasks.add(stepsBg, stepsTask);
+  Tasks.add(batteryBg, batteryTask);
+  Tasks.add(timersBg, timersTask);
+
+  bootStep(5);
 
   // code for displaying stuff when taking pics for ads
   // while(1) {
   //   TM8.dispStr("big ", 0);
   //   TM8.dispStr("tick", 1);
   //   for (int i=0; i<5; i++) {
-  //     digitalWrite(leds[i], 1);
+  //     Leds.set(LED_CH_BAR + i, LED_FULL);
   //   }
   // }
 
-  //if BTN4 isn't pressed, run starter() and second system init
-  if (readBtn4 || fuel.cellPercent() <= 10) {
+  // the full POST is opt-in: hold BTN4 while booting. its probe becomes the new device map
+  if (!readBtn4) {
     starter();
     TM8.sysCheck();
+    saveDeviceMap(Boot.found);
+  }
+  for (uint8_t i=0; i<LED_BAR_LEN; i++) {
+    Leds.fadeTo(LED_CH_BAR + i, 0, BOOT_FADE_MS); // carries on while the watch face comes up
   }
 
-  menuActive = false; // for some reason starter() triggers menuInt(), so I need this to prevent the watch from booting straight into the menu
-  showDateActive = false; // same reason
-  btn2IntActive = false;
-  btn4IntActive = false;
+  Events.flush(); // the POST's buttons (BTN4 held to ask for it) aren't for the home screen
+  Clock.set(CLOCK_8MHZ);
 }
 
 // main function
@@ -0,0 +1,10 @@
+#ifndef _FAKE_ARDUINO_H_
+#define _FAKE_ARDUINO_H_
+
+// just enough of the core for the host tests that build with -I test/fakes
+#include <inttypes.h>
+#include <stddef.h>
+
+typedef void (*voidFuncPtr)(void);
+
+#endif // _FAKE_ARDUINO_H_
@@ -0,0 +1,32 @@
+#ifndef _FAKE_RTCZERO_H_
+#define _FAKE_RTCZERO_H_
+
+#include <Arduino.h>
+
+/*
+RTCZero on the host. The epoch only moves when the test sets it, the alarm is
+only recorded; the test calls the attached interrupt itself when it wants the
+alarm to have gone off.
+*/
+class RTCZero
+{
+public:
+  enum Alarm_Match
+  {
+    MATCH_OFF = 0,
+    MATCH_YYMMDDHHMMSS = 6
+  };
+
+  uint32_t getEpoch(void) { return epoch; }
+  void setAlarmEpoch(uint32_t ts) { alarmEpoch = ts; }
+  void enableAlarm(Alarm_Match match) { alarmMatch = match; }
+  void disableAlarm(void) { alarmMatch = MATCH_OFF; }
+  void attachInterrupt(voidFuncPtr callback) { isr = callback; }
+
+  uint32_t epoch;
+  uint32_t alarmEpoch;
+  Alarm_Match alarmMatch;
+  voidFuncPtr isr;
+};
+
+#endif // _FAKE_RTCZERO_H_
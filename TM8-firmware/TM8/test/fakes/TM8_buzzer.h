@@ -0,0 +1,30 @@
+#ifndef _TM8_BUZZER_H_
+#define _TM8_BUZZER_H_
+
+#include <inttypes.h>
+
+#define BUZZER_PRI_ALARM  2
+
+struct TM8_note
+{
+  uint16_t hz;
+  uint16_t ms;
+};
+
+extern const TM8_note cueAlarm[];
+
+// the buzzer on the host, counts what it was asked to play
+class TM8_buzzer
+{
+public:
+  bool play(const TM8_note *notes, uint8_t priority) {
+    plays++;
+    return true;
+  }
+
+  uint16_t plays;
+};
+
+extern TM8_buzzer Buzzer;
+
+#endif // _TM8_BUZZER_H_
@@ -0,0 +1,24 @@
+#ifndef _TM8_EVENTS_H_
+#define _TM8_EVENTS_H_
+
+#include <inttypes.h>
+
+#define EVENT_ALARM     5
+
+// the ring on the host, keeps the last push
+class TM8_events
+{
+public:
+  bool push(uint8_t type, uint8_t arg = 0) {
+    last = type;
+    pushes++;
+    return true;
+  }
+
+  uint8_t last;
+  uint16_t pushes;
+};
+
+extern TM8_events Events;
+
+#endif // _TM8_EVENTS_H_
@@ -0,0 +1,23 @@
+#ifndef _TM8_LEDS_H_
+#define _TM8_LEDS_H_
+
+#include <inttypes.h>
+
+#define LED_FULL          255
+#define LED_CH_BAR        0
+#define LED_BAR_LEN       5
+
+// the LEDs on the host, keeps the last level set and the fade target per channel
+class TM8_leds
+{
+public:
+  void set(uint8_t ch, uint8_t level) { lit[ch] = level; }
+  void fadeTo(uint8_t ch, uint8_t level, uint16_t ms) { target[ch] = level; }
+
+  uint8_t lit[LED_BAR_LEN];
+  uint8_t target[LED_BAR_LEN];
+};
+
+extern TM8_leds Leds;
+
+#endif // _TM8_LEDS_H_
@@ -0,0 +1,17 @@
+#ifndef _TM8_SLEEP_H_
+#define _TM8_SLEEP_H_
+
+#include <inttypes.h>
+
+// the governor on the host, counts pokes
+class TM8_sleep
+{
+public:
+  void poke(void) { pokes++; }
+
+  uint16_t pokes;
+};
+
+extern TM8_sleep Sleep;
+
+#endif // _TM8_SLEEP_H_
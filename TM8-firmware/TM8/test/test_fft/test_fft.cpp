@@ -0,0 +1,191 @@
+/*
+TM8_fft accuracy, and on the watch its frame time.
+pio test -e native -f test_fft           peak bins on synthetic tones, host frame time
+pio test -e adafruit_feather_m0 -f test_fft   the same, with the frame time at 48MHz
+Tones are built like tachCollect() sees them: 1g of gravity summed in, a few
+hundred mg of vibration, whole mg.
+*/
+#include <math.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include <TM8_fft.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdio.h>
+#include <time.h>
+#endif
+
+#define TONE_MG         300
+#define DC_MG           1000
+#define PEAK_ERR        88 // Q8 bins, 0.34 bin. tach bins are 5.25Hz, so 1.8Hz
+#define TACH_BUDGET_US  12000 // the FIFO holds 24ms at 1344Hz and is drained every 12ms
+
+static int16_t frame[FFT_N];
+static int16_t re[FFT_N];
+static int16_t im[FFT_N];
+
+static void tone(float bin, float mg, float phase) {
+  for (uint16_t i=0; i<FFT_N; i++) {
+    frame[i] = DC_MG + lroundf(mg * sinf(2 * (float)M_PI * bin * i / FFT_N + phase));
+  }
+}
+
+static void addTone(float bin, float mg) {
+  for (uint16_t i=0; i<FFT_N; i++) {
+    frame[i] += lroundf(mg * sinf(2 * (float)M_PI * bin * i / FFT_N));
+  }
+}
+
+static uint32_t peak(uint16_t minBin, uint16_t maxBin) {
+  fftPrepare(frame, re);
+  fftReal(re, im);
+  return fftPeak(re, im, minBin, maxBin);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_prepare_removes_dc_and_scales(void) {
+  tone(16, 100, 0);
+  uint16_t shift = fftPrepare(frame, re);
+  TEST_ASSERT_EQUAL_UINT16(7, shift); // 100 << 7 is the first over 8192
+
+  int32_t sum = 0;
+  int16_t top = 0;
+  for (uint16_t i=0; i<FFT_N; i++) {
+    sum += re[i];
+    if (re[i] > top) top = re[i];
+  }
+  TEST_ASSERT_INT_WITHIN(FFT_N << shift, 0, sum); // mean within one count before the shift
+  TEST_ASSERT_GREATER_OR_EQUAL(8192, top);
+}
+
+void test_prepare_flat_frame(void) {
+  for (uint16_t i=0; i<FFT_N; i++) frame[i] = DC_MG;
+  TEST_ASSERT_EQUAL_UINT16(0, fftPrepare(frame, re));
+  fftReal(re, im);
+  TEST_ASSERT_EQUAL_UINT32(0, fftPeak(re, im, 2, FFT_N / 2 - 2));
+}
+
+// a tone right on a bin has equal neighbours, the refinement adds nothing
+void test_on_bin_tones(void) {
+  static const uint16_t bins[] = {3, 10, 31, 64, 100, 126};
+  for (uint8_t i=0; i<sizeof(bins) / sizeof(bins[0]); i++) {
+    tone(bins[i], TONE_MG, 0.3f * i);
+    TEST_ASSERT_UINT32_WITHIN(8, (uint32_t)bins[i] << 8, peak(2, FFT_N / 2 - 2));
+  }
+}
+
+/*
+between bins the parabola has to pull the result off the strongest one, and
+never away from the tone. without a window the sidelobes make a parabola through
+the power bins fall short of the tone by up to a third of a bin, hence PEAK_ERR
+*/
+void test_between_bin_tones(void) {
+  static const float bins[] = {10.25f, 20.45f, 37.4f, 64.75f, 99.1f, 120.6f};
+  for (uint8_t i=0; i<sizeof(bins) / sizeof(bins[0]); i++) {
+    tone(bins[i], TONE_MG, 0.7f * i);
+    uint32_t p = peak(2, FFT_N / 2 - 2);
+    int32_t target = lroundf(bins[i] * 256);
+    int32_t strongest = lroundf(bins[i]) << 8;
+    TEST_ASSERT_UINT32_WITHIN(PEAK_ERR, target, p);
+    TEST_ASSERT_LESS_OR_EQUAL(abs(target - strongest), abs(target - (int32_t)p)); // the refinement never hurts
+    TEST_ASSERT_UINT32_WITHIN(128, strongest, p); // and stayed within its own bin
+  }
+}
+
+// small vibrations survive the 8 halving stages thanks to fftPrepare()
+void test_small_tone(void) {
+  tone(42.3f, 8, 0);
+  TEST_ASSERT_UINT32_WITHIN(PEAK_ERR, lroundf(42.3f * 256), peak(2, FFT_N / 2 - 2));
+}
+
+void test_strongest_of_two(void) {
+  tone(25, TONE_MG / 3, 0);
+  addTone(70.5f, TONE_MG);
+  TEST_ASSERT_UINT32_WITHIN(PEAK_ERR, 70 * 256 + 128, peak(2, FFT_N / 2 - 2));
+}
+
+// bins outside minBin..maxBin don't win, even when they're stronger
+void test_search_range(void) {
+  tone(5, TONE_MG, 0);
+  addTone(50, TONE_MG / 4);
+  TEST_ASSERT_UINT32_WITHIN(8, 50 << 8, peak(10, FFT_N / 2 - 2));
+}
+
+// a tone just under minBin leaves minBin the strongest in range with a bigger
+// neighbour outside it, so the raw offset runs past half a bin and gets clamped
+void test_offset_clamp(void) {
+  tone(18.8f, TONE_MG, 0);
+  TEST_ASSERT_EQUAL_UINT32(20 * 256 - 128, peak(20, FFT_N / 2 - 2));
+
+  tone(61.2f, TONE_MG, 0);
+  TEST_ASSERT_EQUAL_UINT32(59 * 256 + 128, peak(2, 59));
+}
+
+#ifdef ARDUINO
+#define BENCH_FRAMES 16
+
+// prepare, transform and peak, like one pass of tachShow(). the board boots at 48MHz
+void test_frame_time(void) {
+  tone(37.4f, TONE_MG, 0);
+  uint32_t start = micros();
+  for (uint8_t i=0; i<BENCH_FRAMES; i++) peak(2, FFT_N / 2 - 2);
+  uint32_t us = (micros() - start) / BENCH_FRAMES;
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "256 point frame: %lu us, %lu cycles at 48MHz", (unsigned long)us, (unsigned long)us * 48);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_THAN(TACH_BUDGET_US, us);
+}
+#else
+#define BENCH_FRAMES 20000
+
+// the same pass on the host, for comparing changes to the kernel. x86 us aren't M0+ cycles
+void test_frame_time(void) {
+  uint32_t sum = 0;
+  tone(37.4f, TONE_MG, 0);
+  clock_t start = clock();
+  for (uint16_t i=0; i<BENCH_FRAMES; i++) sum += peak(2, FFT_N / 2 - 2);
+  double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / BENCH_FRAMES;
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "256 point frame: %.2f us on the host", us);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)BENCH_FRAMES * peak(2, FFT_N / 2 - 2), sum); // and the result is used
+}
+#endif
+
+static int runTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prepare_removes_dc_and_scales);
+  RUN_TEST(test_prepare_flat_frame);
+  RUN_TEST(test_on_bin_tones);
+  RUN_TEST(test_between_bin_tones);
+  RUN_TEST(test_small_tone);
+  RUN_TEST(test_strongest_of_two);
+  RUN_TEST(test_search_range);
+  RUN_TEST(test_offset_clamp);
+  RUN_TEST(test_frame_time);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+  delay(2000); // let the test runner open the port
+  runTests();
+}
+
+void loop() {
+}
+#else
+int main(int argc, char **argv) {
+  return runTests();
+}
+#endif
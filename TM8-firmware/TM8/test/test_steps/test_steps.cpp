@@ -0,0 +1,169 @@
+/*
+TM8_steps on the host: pio test -e native -f test_steps
+The counts on synthetic traces, and what the kernel costs per sample.
+Traces are built the way the watch sees them: 50Hz, 8 bit low power samples
+(16mg steps) with gravity on a tilted wrist, sensor noise and, for walks, a
+vertical bounce at the cadence with some sway at half of it. The kernel only
+ever sees the trace array, so a dump from the FIFO drops straight in.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+
+#include <TM8_steps.h>
+
+#define HZ          50
+#define LSB_MG      16 // +-2g, 8 bit
+#define NOISE_MG    24
+#define BENCH_WALKS 50 // times through a two minute walk trace
+
+struct sample
+{
+  int16_t x, y, z;
+};
+
+static sample trace[HZ * 120];
+static uint32_t noiseSeed;
+static TM8_steps steps;
+
+static int16_t noise(void) {
+  noiseSeed = noiseSeed * 1664525 + 1013904223;
+  return (int16_t)((noiseSeed >> 16) % (2 * NOISE_MG + 1)) - NOISE_MG;
+}
+
+static int16_t quantise(float mg) {
+  return (int16_t)lroundf(mg / LSB_MG) * LSB_MG;
+}
+
+// gravity on a wrist held at an angle, plus whatever the arm does along it
+static void put(uint16_t i, float vertical, float sway) {
+  trace[i].x = quantise(200 + 0.2f * vertical + sway + noise());
+  trace[i].y = quantise(-300 - 0.3f * vertical + noise());
+  trace[i].z = quantise(930 + 0.93f * vertical + noise());
+}
+
+// n samples of the wrist at rest, from sample at. returns the next free sample
+static uint16_t rest(uint16_t at, uint16_t n) {
+  for (uint16_t i=0; i<n; i++) put(at + i, 0, 0);
+  return at + n;
+}
+
+// a walk of whole steps at cadence hz with amplitude mg, from sample at
+static uint16_t walk(uint16_t at, uint16_t count, float hz, float mg) {
+  uint16_t n = lroundf(count * HZ / hz);
+  for (uint16_t i=0; i<n; i++) {
+    float ph = 2 * (float)M_PI * hz * i / HZ;
+    put(at + i, mg * sinf(ph) + 0.3f * mg * sinf(2 * ph + 0.7f), 0.3f * mg * sinf(ph / 2));
+  }
+  return at + n;
+}
+
+static void feed(uint16_t n) {
+  for (uint16_t i=0; i<n; i++) steps.feed(trace[i].x, trace[i].y, trace[i].z);
+}
+
+void setUp(void) {
+  noiseSeed = 1;
+  steps.begin(HZ);
+}
+
+void tearDown(void) {
+}
+
+void test_isqrt(void) {
+  TEST_ASSERT_EQUAL_UINT16(0, isqrt32(0));
+  TEST_ASSERT_EQUAL_UINT16(1000, isqrt32(1000000));
+  TEST_ASSERT_EQUAL_UINT16(999, isqrt32(999999));
+  TEST_ASSERT_EQUAL_UINT16(65535, isqrt32(0xFFFFFFFF));
+}
+
+void test_rest_counts_nothing(void) {
+  feed(rest(0, HZ * 60));
+  TEST_ASSERT_EQUAL_UINT32(0, steps.steps);
+}
+
+void test_walk_counts_every_step(void) {
+  uint16_t n = rest(0, HZ * 3);
+  n = walk(n, 108, 1.8f, 250);
+  feed(rest(n, HZ * 3));
+  TEST_ASSERT_UINT32_WITHIN(1, 108, steps.steps);
+}
+
+void test_slow_and_fast_walks(void) {
+  feed(walk(rest(0, HZ * 3), 60, 1.0f, 200));
+  TEST_ASSERT_UINT32_WITHIN(1, 60, steps.steps);
+
+  setUp();
+  feed(walk(rest(0, HZ * 3), 100, 3.0f, 400));
+  TEST_ASSERT_UINT32_WITHIN(1, 100, steps.steps);
+}
+
+// bumps and waves shorter than STEP_REGULATION swings, each followed by a pause
+// longer than STEP_MAX_INTERVAL, never add up to a walk
+void test_short_bursts_rejected(void) {
+  uint16_t n = rest(0, HZ * 3);
+  for (uint8_t i=0; i<5; i++) {
+    n = walk(n, STEP_REGULATION - 1, 2.0f, 300);
+    n = rest(n, HZ * 3);
+  }
+  feed(n);
+  TEST_ASSERT_EQUAL_UINT32(0, steps.steps);
+}
+
+// the steps held back while regulating are booked once the walk is confirmed
+void test_regulation_books_held_steps(void) {
+  feed(rest(walk(rest(0, HZ * 3), STEP_REGULATION, 2.0f, 300), HZ * 3));
+  TEST_ASSERT_EQUAL_UINT32(STEP_REGULATION, steps.steps);
+}
+
+void test_small_swings_ignored(void) {
+  feed(walk(rest(0, HZ * 3), 60, 1.8f, STEP_MIN_THRESH / 4));
+  TEST_ASSERT_EQUAL_UINT32(0, steps.steps);
+}
+
+void test_active_minutes(void) {
+  feed(walk(rest(0, HZ * 3), 108, 1.8f, 250)); // one minute of walking
+  steps.minuteTick();
+  TEST_ASSERT_EQUAL_UINT16(1, steps.activeMinutes);
+
+  setUp();
+  feed(walk(rest(0, HZ * 3), STEP_ACTIVE_PER_MIN / 2, 1.0f, 250)); // too few for an active minute
+  steps.minuteTick();
+  TEST_ASSERT_EQUAL_UINT16(0, steps.activeMinutes);
+  TEST_ASSERT_UINT32_WITHIN(1, STEP_ACTIVE_PER_MIN / 2, steps.steps);
+
+  steps.resetDay();
+  TEST_ASSERT_EQUAL_UINT32(0, steps.steps);
+}
+
+/*
+host time per feed(), a walk trace so every branch of the kernel is taken. x86 ns
+don't map onto M0+ cycles, but it compares kernels: feed() does an isqrt32 and a
+handful of adds and compares, and runs 50 times a second on the watch
+*/
+void test_feed_cost(void) {
+  uint16_t n = walk(rest(0, HZ * 3), 200, 1.8f, 250);
+  clock_t start = clock();
+  for (uint8_t r=0; r<BENCH_WALKS; r++) feed(n);
+  double ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ((uint32_t)n * BENCH_WALKS);
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "feed(): %.1f ns a sample on the host", ns);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(steps.steps > 0); // keeps the loop from being optimised away
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_isqrt);
+  RUN_TEST(test_rest_counts_nothing);
+  RUN_TEST(test_walk_counts_every_step);
+  RUN_TEST(test_slow_and_fast_walks);
+  RUN_TEST(test_short_bursts_rejected);
+  RUN_TEST(test_regulation_books_held_steps);
+  RUN_TEST(test_small_swings_ignored);
+  RUN_TEST(test_active_minutes);
+  RUN_TEST(test_feed_cost);
+  return UNITY_END();
+}
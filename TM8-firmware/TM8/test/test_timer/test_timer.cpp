@@ -0,0 +1,215 @@
+/*
+TM8_timer on the host: pio test -e native -f test_timer
+The RTC, sleep governor, event ring, buzzer and LEDs are the fakes in
+test/fakes. The epoch only moves when a test sets it, and the alarm only
+"goes off" when a test calls the interrupt RTCZero was given.
+*/
+#include <unity.h>
+
+#include <RTCZero.h>
+#include <TM8_sleep.h>
+#include <TM8_events.h>
+#include <TM8_buzzer.h>
+#include <TM8_leds.h>
+#include <TM8_timer.h>
+
+#define T0              1000000 // any epoch will do, well clear of 0
+
+TM8_sleep Sleep;
+TM8_events Events;
+TM8_buzzer Buzzer;
+TM8_leds Leds;
+const TM8_note cueAlarm[] = {{0, 0}};
+
+static RTCZero rtc;
+
+// ids in the order the callbacks ran
+static uint8_t ran[32];
+static uint8_t ranCount;
+
+static void record(uint8_t id) {
+  if (ranCount < sizeof(ran)) ran[ranCount++] = id;
+}
+
+static uint8_t cancelTarget;
+
+static void cancelOther(uint8_t id) {
+  record(id);
+  Timers.cancel(cancelTarget);
+}
+
+// the RTC runs on to epoch, passing the alarm second on the way if it's set
+static void advance(uint32_t epoch) {
+  bool passed = (int32_t)(rtc.alarmEpoch - rtc.epoch) > 0 && (int32_t)(epoch - rtc.alarmEpoch) >= 0;
+  rtc.epoch = epoch;
+  if (rtc.alarmMatch != RTCZero::MATCH_OFF && passed) rtc.isr();
+}
+
+void setUp(void) {
+  rtc = RTCZero();
+  rtc.epoch = T0;
+  Sleep = TM8_sleep();
+  Events = TM8_events();
+  Buzzer = TM8_buzzer();
+  Leds = TM8_leds();
+  ranCount = 0;
+  Timers.begin(&rtc);
+}
+
+void tearDown(void) {
+}
+
+void test_alarm_follows_the_earliest(void) {
+  Timers.in(30, record);
+  TEST_ASSERT_EQUAL_UINT32(T0 + 30, rtc.alarmEpoch);
+  TEST_ASSERT_EQUAL(RTCZero::MATCH_YYMMDDHHMMSS, rtc.alarmMatch);
+  Timers.in(10, record);
+  TEST_ASSERT_EQUAL_UINT32(T0 + 10, rtc.alarmEpoch);
+  Timers.in(20, record);
+  TEST_ASSERT_EQUAL_UINT32(T0 + 10, rtc.alarmEpoch);
+  TEST_ASSERT_FALSE(Timers.fired);
+}
+
+// added in any order, they run earliest first, whichever service() call picks them up
+void test_heap_ordering(void) {
+  static const uint8_t secs[] = {50, 10, 70, 30, 20, 80, 60, 40};
+  uint8_t ids[TIMER_MAX];
+  for (uint8_t i=0; i<TIMER_MAX; i++) ids[i] = Timers.in(secs[i], record);
+  TEST_ASSERT_EQUAL_UINT8(TIMER_MAX, Timers.count());
+
+  advance(T0 + 45); // four due at once
+  TEST_ASSERT_TRUE(Timers.fired);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_ALARM, Events.last);
+  Timers.service();
+  TEST_ASSERT_FALSE(Timers.fired);
+  TEST_ASSERT_EQUAL_UINT8(4, ranCount);
+  TEST_ASSERT_EQUAL_UINT32(T0 + 50, rtc.alarmEpoch);
+
+  rtc.epoch = T0 + 80;
+  Timers.service();
+  static const uint8_t order[] = {1, 4, 3, 7, 0, 6, 2, 5}; // indexes into secs, by due time
+  TEST_ASSERT_EQUAL_UINT8(TIMER_MAX, ranCount);
+  for (uint8_t i=0; i<TIMER_MAX; i++) TEST_ASSERT_EQUAL_UINT8(ids[order[i]], ran[i]);
+  TEST_ASSERT_EQUAL_UINT8(0, Timers.count());
+  TEST_ASSERT_EQUAL(RTCZero::MATCH_OFF, rtc.alarmMatch);
+}
+
+void test_full_heap(void) {
+  for (uint8_t i=0; i<TIMER_MAX; i++) TEST_ASSERT_NOT_EQUAL(TIMER_NONE, Timers.in(i + 1, record));
+  TEST_ASSERT_EQUAL_UINT8(TIMER_NONE, Timers.in(100, record));
+  TEST_ASSERT_EQUAL_UINT8(TIMER_MAX, Timers.count());
+}
+
+void test_cancel(void) {
+  uint8_t a = Timers.in(10, record);
+  uint8_t b = Timers.in(20, record);
+  uint8_t c = Timers.in(30, record);
+
+  TEST_ASSERT_TRUE(Timers.cancel(a)); // the earliest, the alarm moves on to the next
+  TEST_ASSERT_FALSE(Timers.pending(a));
+  TEST_ASSERT_EQUAL_UINT32(T0 + 20, rtc.alarmEpoch);
+  TEST_ASSERT_FALSE(Timers.cancel(a));
+  TEST_ASSERT_FALSE(Timers.cancel(TIMER_NONE));
+  TEST_ASSERT_EQUAL_UINT32(0, Timers.left(a));
+  TEST_ASSERT_EQUAL_UINT32(30, Timers.left(c));
+
+  rtc.epoch = T0 + 40;
+  Timers.service();
+  TEST_ASSERT_EQUAL_UINT8(2, ranCount);
+  TEST_ASSERT_EQUAL_UINT8(b, ran[0]);
+  TEST_ASSERT_EQUAL_UINT8(c, ran[1]);
+
+  TEST_ASSERT_TRUE(Timers.cancel(Timers.in(5, record))); // the last one, the alarm goes off
+  TEST_ASSERT_EQUAL(RTCZero::MATCH_OFF, rtc.alarmMatch);
+}
+
+// a callback cancelling a timer that's due in the same service() stops it running
+void test_cancel_from_callback(void) {
+  Timers.in(10, cancelOther);
+  cancelTarget = Timers.in(20, record);
+  rtc.epoch = T0 + 30;
+  Timers.service();
+  TEST_ASSERT_EQUAL_UINT8(1, ranCount);
+  TEST_ASSERT_EQUAL_UINT8(0, Timers.count());
+}
+
+// the RTC alarm only matches exactly, a deadline already past is flagged instead
+void test_past_due_arm(void) {
+  uint8_t id = Timers.at(T0 - 5, record);
+  TEST_ASSERT_TRUE(Timers.fired);
+  TEST_ASSERT_EQUAL_UINT16(1, Sleep.pokes);
+  TEST_ASSERT_EQUAL_UINT16(0, Events.pushes); // that's the alarm interrupt's job, it never came
+
+  Timers.service();
+  TEST_ASSERT_EQUAL_UINT8(1, ranCount);
+  TEST_ASSERT_EQUAL_UINT8(id, ran[0]);
+  TEST_ASSERT_FALSE(Timers.fired);
+
+  Timers.in(0, record); // due this very second
+  TEST_ASSERT_TRUE(Timers.fired);
+}
+
+// an interval timer slept through fires once and resumes on its own grid
+void test_interval_skips_missed_periods(void) {
+  uint8_t id = Timers.every(10, record);
+  TEST_ASSERT_EQUAL_UINT32(T0 + 10, rtc.alarmEpoch);
+
+  advance(T0 + 10);
+  Timers.service();
+  TEST_ASSERT_EQUAL_UINT8(1, ranCount);
+  TEST_ASSERT_TRUE(Timers.pending(id));
+  TEST_ASSERT_EQUAL_UINT32(T0 + 20, rtc.alarmEpoch);
+
+  rtc.epoch = T0 + 57; // four periods went by in STANDBY
+  Timers.service();
+  TEST_ASSERT_EQUAL_UINT8(2, ranCount);
+  TEST_ASSERT_EQUAL_UINT8(id, ran[1]);
+  TEST_ASSERT_EQUAL_UINT32(T0 + 60, rtc.alarmEpoch);
+  TEST_ASSERT_EQUAL_UINT32(3, Timers.left(id));
+
+  rtc.epoch = T0 + 60; // landing on a period doesn't fire it twice
+  Timers.service();
+  TEST_ASSERT_EQUAL_UINT8(3, ranCount);
+  TEST_ASSERT_EQUAL_UINT32(T0 + 70, rtc.alarmEpoch);
+  TEST_ASSERT_FALSE(Timers.fired);
+}
+
+void test_ids(void) {
+  uint8_t a = Timers.in(10, record);
+  uint8_t b = Timers.in(10, record);
+  TEST_ASSERT_NOT_EQUAL(TIMER_NONE, a);
+  TEST_ASSERT_NOT_EQUAL(a, b);
+
+  for (uint16_t i=0; i<300; i++) { // wrap the id counter, past TIMER_NONE and the two still pending
+    uint8_t id = Timers.in(20, record);
+    TEST_ASSERT_NOT_EQUAL(TIMER_NONE, id);
+    TEST_ASSERT_NOT_EQUAL(a, id);
+    TEST_ASSERT_NOT_EQUAL(b, id);
+    Timers.cancel(id);
+  }
+}
+
+void test_cues(void) {
+  Timers.in(10, 0, TIMER_CUE_BEEP | TIMER_CUE_LEDS);
+  rtc.epoch = T0 + 10;
+  Timers.service();
+  TEST_ASSERT_EQUAL_UINT16(1, Buzzer.plays);
+  for (uint8_t i=0; i<LED_BAR_LEN; i++) {
+    TEST_ASSERT_EQUAL_UINT8(LED_FULL, Leds.lit[LED_CH_BAR + i]);
+    TEST_ASSERT_EQUAL_UINT8(0, Leds.target[LED_CH_BAR + i]);
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_alarm_follows_the_earliest);
+  RUN_TEST(test_heap_ordering);
+  RUN_TEST(test_full_heap);
+  RUN_TEST(test_cancel);
+  RUN_TEST(test_cancel_from_callback);
+  RUN_TEST(test_past_due_arm);
+  RUN_TEST(test_interval_skips_missed_periods);
+  RUN_TEST(test_ids);
+  RUN_TEST(test_cues);
+  return UNITY_END();
+}